@@ -2,6 +2,20 @@
 #include <iostream>
 #include <Windows.h>
 #include"color.h"
+#include"blur.hpp"
+#include"convolve.hpp"
+#include"morphology.hpp"
+#include"edges.hpp"
+#include"bloom.hpp"
+#include"stats.hpp"
+#include"clahe.hpp"
+#include"pixelsort.hpp"
+#include"displace.hpp"
+#include"remap.hpp"
+#include"mosaic.hpp"
+#include"palette.hpp"
+#include"indexed.hpp"
+#include"dct.hpp"
 class ScreenGDI {
 public:
     HDC hdcDesktop;          //豸
@@ -10,6 +24,9 @@ public:
     int height;              // ߶
     HBITMAP hbmTemp;         // ʱλͼ
     PRGBQUAD rgbScreen;      // 
+    SurfacePool scratch;     // Чõʱ
+    RemapCache remaps;       // ӳЧ決õӳ
+    FrameHistory frames;     // ֡Ч֮Ҫһ֡Чã
 
     ScreenGDI() {
         hdcDesktop = GetDC(NULL);  // ȡ豸
@@ -48,6 +65,50 @@ public:
     void AdjustRGB(int xStart, int yStart, int xEnd, int yEnd, int rIncrease, int gIncrease, int bIncrease); 
     //ֱ趨ĳRGBֵ
     void SetRGB(int xStart, int yStart, int xEnd, int yEnd, BYTE newR, BYTE newG, BYTE newB);
+    //˹ģ sigmaΪ׼أ
+    void Blur(float sigma);
+    //ģ Ϊ(2*radius+1)x(2*radius+1)
+    void BoxBlur(int radius);
+    //  ConvolutionKernel::Sharpen()ConvolutionKernel::Emboss() Զ
+    void Convolve(const ConvolutionKernel& kernel);
+    //ֵ˲ Ϊ(2*radius+1)x(2*radius+1)
+    void Median(int radius);
+    //ͣĲţ/ʴĲţ
+    void Dilate(int radius);
+    void Erode(int radius);
+    //colorԵ thinΪtrueʱԵֻһؿ
+    void DrawEdges(COLORREF color, bool thin = false);
+    // ȳthresholdĲܷ
+    void Bloom(BYTE threshold = 160, float intensity = 1.0f);
+    //ͳƵǰĻƽɫֱֵͼ step>1ʱֻÿstep
+    void Analyze(SurfaceStats& stats, int step = 4);
+    //Զɫ / ֱͼ⻯
+    void AutoLevels(float clip = 0.005f);
+    void Equalize();
+    //ӦԱȶȣCLAHE ֳ8x8ֱ⻯ clipLimitԽԱȶԽǿ
+    void AdaptiveContrast(float clipLimit = 2.0f);
+    // [low,high]ڵذֵңverticalΪtrueʱϵ£
+    void PixelSort(bool vertical = false, SortKey key = SORT_LUMA, BYTE low = 64, BYTE high = 255);
+    //ˮƽ ÿһаƶ periodΪһڵ phaseÿ֡ܶ
+    void Wave(float amplitude, float period, float phase);
+    //RGB ɫͨoffset ɫͨoffset
+    void RGBSplit(int offset);
+    //ӳЧСۡͲˮ ʱstep stepӳֵ֮
+    void Remap(RemapEffect effect, float parameter, float step = 0.0f);
+    // ÿblock x blockȡƽɫ
+    void Pixelate(int block);
+    //ɫ ÿֻͨlevelsɫ patternΪͼ
+    void Posterize(int levels, DitherPattern pattern = DITHER_BAYER4);
+    //ɫ ǰcolorsɫĵɫ壨˲ ditherΪtrueʱɢ
+    void Quantize(int colors, bool dither = true);
+    //ѵǰĻתcolorsɫ ֮ĵɫ壨CyclePaletteShowIndexedǵɫ嶯
+    void CaptureIndexed(IndexedSurface& indexed, int colors = 256);
+    //ߴĻͬʱֻʾϽصĲ indexedΪջڴ治ʱfalse
+    bool ShowIndexed(const IndexedSurface& indexed);
+    //JPEGѹʧ qualityԽͿԽ corruptionΪÿ8x8鱻ƻĸ
+    void JpegArtifacts(int quality, float corruption = 0.0f);
+    // ÿ16x16amountĸ˶һ֡ òЧ
+    void Datamosh(float amount = 1.0f, int quality = 30);
     void DrawImageToBitmap(HBITMAP hBitmap);
     void LoadAndDrawImageFromResource(int resourceID);
 };
@@ -109,44 +170,270 @@ void ScreenGDI::SetRGB(int xStart, int yStart, int xEnd, int yEnd, BYTE newR, BY
     }
     BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
 }
+void ScreenGDI::Blur(float sigma) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    // ģе˳޹أ¶ϵ DIB ҲֱӰװ Surface
+    Surface view(rgbScreen, width, height);
+    GaussianBlur(view, sigma);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::BoxBlur(int radius) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::BoxBlur(view, radius);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Convolve(const ConvolutionKernel& kernel) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    // ¶ϵģҲҪ·ת
+    Surface view(rgbScreen, width, height);
+    ::Convolve(view, kernel.FlipVertical());
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Median(int radius) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    MedianFilter(view, radius);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Dilate(int radius) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::Dilate(view, radius);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Erode(int radius) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::Erode(view, radius);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::DrawEdges(COLORREF color, bool thin) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::DrawEdges(view, color, 255, EDGE_SOBEL, thin);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Bloom(BYTE threshold, float intensity) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ApplyBloom(view, scratch, threshold, intensity);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Analyze(SurfaceStats& stats, int step) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    Surface view(rgbScreen, width, height);
+    AnalyzeSurface(view, stats, step);
+}
+
+void ScreenGDI::AutoLevels(float clip) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::AutoLevels(view, clip, 2);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Equalize() {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    EqualizeHistogram(view, 2);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::AdaptiveContrast(float clipLimit) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    // Ļ¶Գƣ¶ϵҲֱӴ
+    Surface view(rgbScreen, width, height);
+    ApplyCLAHE(view, 8, 8, clipLimit);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::PixelSort(bool vertical, SortKey key, BYTE low, BYTE high) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    if (vertical) {
+        // ¶ϣĻϲǴϵµ
+        PixelSortColumns(view, key, low, high, true);
+    }
+    else {
+        PixelSortRows(view, key, low, high);
+    }
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Wave(float amplitude, float period, float phase) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    std::vector<int> offsets;
+    SineOffsets(offsets, height, amplitude, period, phase);
+    DisplaceRows(view, offsets.data());
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::RGBSplit(int offset) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    std::vector<int> right(height, offset);
+    std::vector<int> left(height, -offset);
+    DisplaceChannels(view, left.data(), NULL, right.data(), false);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Remap(RemapEffect effect, float parameter, float step) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    Surface view(rgbScreen, width, height);
+    Surface& source = scratch.Acquire(width, height);
+    // ԴͼĿʱ任Ļԭ
+    if (source.Empty()) {
+        scratch.Release(source);
+        return;
+    }
+    memcpy(source.pixels, rgbScreen, (size_t)width * height * sizeof(_RGBQUAD));
+    ::Remap(source, view, remaps.Get(effect, parameter, width, height, step));
+    scratch.Release(source);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Pixelate(int block) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::Pixelate(view, block);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Posterize(int levels, DitherPattern pattern) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ::Posterize(view, levels, pattern);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Quantize(int colors, bool dither) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    Surface view(rgbScreen, width, height);
+    Palette palette;
+    BuildOctreePalette(view, colors, palette);
+    if (dither) {
+        DitherToPalette(view, palette);
+    }
+    else {
+        MapToPalette(view, palette);
+    }
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::CaptureIndexed(IndexedSurface& indexed, int colors) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    Surface view(rgbScreen, width, height);
+    Palette palette;
+    BuildOctreePalette(view, colors, palette);
+    indexed.FromSurface(view, palette);
+}
+
+bool ScreenGDI::ShowIndexed(const IndexedSurface& indexed) {
+    if (indexed.Empty()) {
+        return false;
+    }
+    Surface view(rgbScreen, width, height);
+    if (indexed.width == width && indexed.height == height) {
+        indexed.Expand(view);
+        BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+        return true;
+    }
+    // ߴ粻ͬȡ֮˷ֱʣչʱ棬ֻصĲֿĻϣಿֱԭ
+    Surface& expanded = scratch.Acquire(indexed.width, indexed.height);
+    if (expanded.Empty()) {
+        scratch.Release(expanded);
+        return false;
+    }
+    indexed.Expand(expanded);
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    int w = min(width, indexed.width);
+    int h = min(height, indexed.height);
+    // Ļλͼ¶ϵģCaptureIndexed صҲһвĻϣһж
+    for (int y = 0; y < h; y++) {
+        memcpy(view.Row(height - h + y), expanded.Row(indexed.height - h + y), w * sizeof(_RGBQUAD));
+    }
+    scratch.Release(expanded);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+    return true;
+}
+
+void ScreenGDI::JpegArtifacts(int quality, float corruption) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    Surface view(rgbScreen, width, height);
+    ApplyDCTArtifacts(view, quality, corruption, GetTickCount());
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
+void ScreenGDI::Datamosh(float amount, int quality) {
+    BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
+    GdiFlush();
+    Surface view(rgbScreen, width, height);
+    DWORD seed = GetTickCount();
+    const Surface* previous = frames.Get(0);
+    if (previous != NULL) {
+        ::Datamosh(view, *previous, amount, seed);
+    }
+    ApplyDCTArtifacts(view, quality, 0.0f, seed);
+    frames.Push(view);
+    BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
+}
+
 void ScreenGDI::AdjustBrightness(float factor) {
     BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
-    for (int i = 0; i < width * height; i++) {
-        HSLQUAD hsl = RGBToHSL(rgbScreen[i]);
+    Surface view(rgbScreen, width, height);
+    ForEachPixel(view, [factor](_RGBQUAD& pixel) {
+        HSLQUAD hsl = RGBToHSL(pixel);
         hsl.l *= factor;
         _RGBQUAD rgb = HSLToRGB(hsl);
-        rgbScreen[i].r = rgb.r;
-        rgbScreen[i].g = rgb.g;
-        rgbScreen[i].b = rgb.b;
-    }
+        pixel.r = rgb.r;
+        pixel.g = rgb.g;
+        pixel.b = rgb.b;
+    });
 
     BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
 }
 
 void ScreenGDI::AdjustContrast(float factor) {
     BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
-    for (int i = 0; i < width * height; i++) {
-        HSLQUAD hsl = RGBToHSL(rgbScreen[i]);
+    Surface view(rgbScreen, width, height);
+    ForEachPixel(view, [factor](_RGBQUAD& pixel) {
+        HSLQUAD hsl = RGBToHSL(pixel);
         hsl.l = 0.5f + (hsl.l - 0.5f) * factor;
         _RGBQUAD rgb = HSLToRGB(hsl);
-        rgbScreen[i].r = rgb.r;
-        rgbScreen[i].g = rgb.g;
-        rgbScreen[i].b = rgb.b;
-    }
+        pixel.r = rgb.r;
+        pixel.g = rgb.g;
+        pixel.b = rgb.b;
+    });
 
     BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
 }
 
 void ScreenGDI::AdjustSaturation(float factor) {
     BitBlt(hdcMem, 0, 0, width, height, hdcDesktop, 0, 0, SRCCOPY);
-    for (int i = 0; i < width * height; i++) {
-        HSLQUAD hsl = RGBToHSL(rgbScreen[i]);
+    Surface view(rgbScreen, width, height);
+    ForEachPixel(view, [factor](_RGBQUAD& pixel) {
+        HSLQUAD hsl = RGBToHSL(pixel);
         hsl.s *= factor;
         _RGBQUAD rgb = HSLToRGB(hsl);
-        rgbScreen[i].r = rgb.r;
-        rgbScreen[i].g = rgb.g;
-        rgbScreen[i].b = rgb.b;
-    }
+        pixel.r = rgb.r;
+        pixel.g = rgb.g;
+        pixel.b = rgb.b;
+    });
 
     BitBlt(hdcDesktop, 0, 0, width, height, hdcMem, 0, 0, SRCCOPY);
 }
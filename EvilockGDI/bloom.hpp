@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <Windows.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "resample.hpp"
+#include "blur.hpp"
+
+// 亮部提取：每个通道减去 threshold，剩下的部分再拉伸回 0～255 并乘以 gain（0～1），暗于阈值的部分变成黑色
+inline void BrightPass(Surface& surface, BYTE threshold, float gain = 1.0f) {
+    gain = max(0.0f, min(1.0f, gain));
+    if (surface.Empty() || (threshold == 0 && gain >= 1.0f)) {
+        return;
+    }
+    // 拉伸系数是 8.8 定点数，(255 - threshold) * scale 不超过 16 位
+    WORD scale = (WORD)((int)(255 * 256 * gain + 0.5f) / (255 - min(threshold, (BYTE)254)));
+    ParallelFor(surface.height, [&surface, threshold, scale](int begin, int end) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i t = _mm_set1_epi8((char)threshold);
+        const __m128i k = _mm_set1_epi16((short)scale);
+        for (int y = begin; y < end; y++) {
+            PRGBQUAD row = surface.Row(y);
+            int x = 0;
+            for (; x + 4 <= surface.width; x += 4) {
+                __m128i p = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)(row + x)), t);
+                __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), k), 8);
+                __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), k), 8);
+                _mm_storeu_si128((__m128i*)(row + x), _mm_packus_epi16(lo, hi));
+            }
+            for (; x < surface.width; x++) {
+                BYTE* c = (BYTE*)(row + x);
+                for (int i = 0; i < 4; i++) {
+                    c[i] = (BYTE)(max(0, c[i] - threshold) * scale >> 8);
+                }
+            }
+        }
+    }, 16);
+}
+
+// 泛光：亮部提取后逐级缩小一半（mip 链），每一级做一次小半径模糊，再从最小的一级开始逐级放大相加，
+// 最后把各级的平均乘以 intensity 加回原图。亮部提取时就先乘以 1 / 级数，后面的级别都从它缩小而来，
+// 逐级相加的和不超过 255，不会在 8 位上提前饱和。每级的模糊半径相同，但越小的级别覆盖的原图范围越大，
+// 合起来是一个很宽的光晕，计算量却只有原图尺寸上做大半径模糊的一小部分
+// 中间结果都从 pool 里取，连续多帧调用时不会重复创建位图
+inline void ApplyBloom(Surface& surface, SurfacePool& pool, BYTE threshold = 160, float intensity = 1.0f, int levels = 5, float sigma = 1.5f) {
+    if (surface.Empty() || levels <= 0) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    // 先算出实际的级数（图太小时缩到 1 个像素就停）
+    int count = 0;
+    for (int cw = w, ch = h; count < levels && cw > 1 && ch > 1; count++) {
+        cw = (cw + 1) / 2;
+        ch = (ch + 1) / 2;
+    }
+    if (count == 0) {
+        return;
+    }
+    std::vector<Surface*> chain;
+    const Surface* previous = &surface;
+    for (int i = 0; i < count; i++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        Surface& level = pool.Acquire(w, h);
+        Downsample2x(*previous, level);
+        // 在半尺寸上提取亮部，比在原图上做便宜四倍
+        if (i == 0) {
+            BrightPass(level, threshold, 1.0f / count);
+        }
+        chain.push_back(&level);
+        previous = &level;
+    }
+    for (size_t i = 0; i < chain.size(); i++) {
+        ExactGaussianBlur(*chain[i], sigma);
+    }
+    for (size_t i = chain.size() - 1; i > 0; i--) {
+        UpsampleAdd(*chain[i], *chain[i - 1]);
+    }
+    UpsampleAdd(*chain[0], surface, intensity);
+    for (size_t i = 0; i < chain.size(); i++) {
+        pool.Release(*chain[i]);
+    }
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 限制对比度的自适应直方图均衡化（CLAHE）：画面切成 tilesX x tilesY 块，每块按自己的亮度直方图均衡化，
+// 直方图每个桶的计数不超过平均值的 clipLimit 倍（超出部分平均分给所有桶），避免平坦区域的噪点被放大
+// 每块的映射做成一张查找表，像素的结果由周围四块的查找表按到块中心的距离双线性插值，块之间没有接缝
+// 统计各块直方图（按块并行）之后只对整帧扫描一遍（按行并行），b、g、r 三个通道用同一组表映射
+inline void ApplyCLAHE(Surface& surface, int tilesX = 8, int tilesY = 8, float clipLimit = 2.0f) {
+    if (surface.Empty()) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    tilesX = max(1, min(tilesX, w));
+    tilesY = max(1, min(tilesY, h));
+    // 第 t 块的查找表从 tables[t * 256] 开始
+    std::vector<BYTE> tables((size_t)tilesX * tilesY * 256);
+    ParallelFor(tilesX * tilesY, [&surface, &tables, w, h, tilesX, tilesY, clipLimit](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            int tx = t % tilesX;
+            int ty = t / tilesX;
+            int x0 = tx * w / tilesX, x1 = (tx + 1) * w / tilesX;
+            int y0 = ty * h / tilesY, y1 = (ty + 1) * h / tilesY;
+            DWORD hist[256] = { 0 };
+            for (int y = y0; y < y1; y++) {
+                const _RGBQUAD* row = surface.Row(y);
+                for (int x = x0; x < x1; x++) {
+                    hist[(row[x].b * 29 + row[x].g * 150 + row[x].r * 77 + 128) >> 8]++;
+                }
+            }
+            DWORD count = (DWORD)((x1 - x0) * (y1 - y0));
+            // 截断直方图，多出来的计数平均分回每个桶，除不尽的部分从 0 号桶开始每桶补一个
+            DWORD limit = max((DWORD)1, (DWORD)(clipLimit * count / 256));
+            DWORD excess = 0;
+            for (int i = 0; i < 256; i++) {
+                if (hist[i] > limit) {
+                    excess += hist[i] - limit;
+                    hist[i] = limit;
+                }
+            }
+            DWORD share = excess / 256;
+            DWORD rest = excess % 256;
+            BYTE* table = &tables[(size_t)t * 256];
+            DWORD total = 0;
+            for (int i = 0; i < 256; i++) {
+                total += hist[i] + share + (i < (int)rest ? 1 : 0);
+                table[i] = (BYTE)((ULONGLONG)total * 255 / max((DWORD)1, count));
+            }
+        }
+    }, 1);
+
+    // 每一列 / 每一行左右（上下）两个块的编号和右（下）块的权重（0～256），像素在最外侧块中心以外时只用一块
+    struct Neighbors {
+        int first;
+        int second;
+        int weight;
+    };
+    auto neighbors = [](int size, int tiles, std::vector<Neighbors>& out) {
+        out.resize(size);
+        for (int i = 0; i < size; i++) {
+            // 块的中心在 (k + 0.5) * size / tiles，按这个坐标换算到“块编号”空间
+            float pos = (i + 0.5f) * tiles / size - 0.5f;
+            int k = (int)floorf(pos);
+            float fraction = pos - k;
+            out[i].first = max(0, min(tiles - 1, k));
+            out[i].second = max(0, min(tiles - 1, k + 1));
+            out[i].weight = (int)(fraction * 256.0f + 0.5f);
+        }
+    };
+    std::vector<Neighbors> columns, rows;
+    neighbors(w, tilesX, columns);
+    neighbors(h, tilesY, rows);
+
+    ParallelFor(h, [&surface, &tables, &columns, &rows, w, tilesX](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            PRGBQUAD row = surface.Row(y);
+            const BYTE* top = &tables[(size_t)rows[y].first * tilesX * 256];
+            const BYTE* bottom = &tables[(size_t)rows[y].second * tilesX * 256];
+            int wy = rows[y].weight;
+            for (int x = 0; x < w; x++) {
+                const Neighbors& n = columns[x];
+                const BYTE* tl = top + n.first * 256;
+                const BYTE* tr = top + n.second * 256;
+                const BYTE* bl = bottom + n.first * 256;
+                const BYTE* br = bottom + n.second * 256;
+                int wx = n.weight;
+                BYTE* c = (BYTE*)(row + x);
+                for (int i = 0; i < 3; i++) {
+                    int v = c[i];
+                    int upper = tl[v] * (256 - wx) + tr[v] * wx;
+                    int lower = bl[v] * (256 - wx) + br[v] * wx;
+                    c[i] = (BYTE)((upper * (256 - wy) + lower * wy + 32768) >> 16);
+                }
+            }
+        }
+    }, 16);
+}
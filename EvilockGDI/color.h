@@ -9,7 +9,10 @@ typedef union _RGBQUAD {
 		BYTE b;
 		BYTE g;
 		BYTE r;
-		BYTE unused;
+		union {
+			BYTE unused;
+			BYTE a;//32λ/Ϊ alpha ͨʹ
+		};
 	};
 } *PRGBQUAD;
 typedef struct {
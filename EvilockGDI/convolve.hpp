@@ -0,0 +1,329 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 卷积核：weights 按行存放，中心在 (width / 2, height / 2)，结果再加上 bias（0～255）
+// 宽高为偶数时在右 / 下补一列 / 一行 0，保证中心落在像素上
+class ConvolutionKernel {
+public:
+    int width;
+    int height;
+    std::vector<float> weights;
+    float bias;
+
+    // values 按行给出 w x h 个权重，全部除以 divisor
+    ConvolutionKernel(int w, int h, const float* values, float divisor = 1.0f, float bias = 0.0f)
+        : width(w | 1), height(h | 1), weights((size_t)(w | 1) * (h | 1), 0.0f), bias(bias) {
+        float scale = divisor != 0.0f ? 1.0f / divisor : 1.0f;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                weights[(size_t)y * width + x] = values[y * w + x] * scale;
+            }
+        }
+    }
+
+    float At(int x, int y) const {
+        return weights[(size_t)y * width + x];
+    }
+    // 上下翻转，用于自下而上存放的像素（例如 ScreenGDI::rgbScreen）
+    ConvolutionKernel FlipVertical() const {
+        ConvolutionKernel flipped(*this);
+        for (int y = 0; y < height; y++) {
+            memcpy(&flipped.weights[(size_t)y * width], &weights[(size_t)(height - 1 - y) * width], width * sizeof(float));
+        }
+        return flipped;
+    }
+
+    // 秩为 1 的核可以拆成 column（竖直）和 row（水平）两个一维核：K[y][x] = column[y] * row[x]
+    // 以绝对值最大的元素所在的行、列为基，再检查其余每个元素是否吻合
+    bool IsSeparable(std::vector<float>& column, std::vector<float>& row) const {
+        int px = 0, py = 0;
+        for (int i = 0; i < (int)weights.size(); i++) {
+            if (fabsf(weights[i]) > fabsf(weights[(size_t)py * width + px])) {
+                px = i % width;
+                py = i / width;
+            }
+        }
+        float pivot = At(px, py);
+        if (pivot == 0.0f) {
+            return false;
+        }
+        column.resize(height);
+        row.resize(width);
+        for (int y = 0; y < height; y++) {
+            column[y] = At(px, y);
+        }
+        for (int x = 0; x < width; x++) {
+            row[x] = At(x, py) / pivot;
+        }
+        float tolerance = fabsf(pivot) * 1e-4f;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (fabsf(column[y] * row[x] - At(x, y)) > tolerance) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // 锐化：amount 越大越锐利
+    static ConvolutionKernel Sharpen(float amount = 1.0f) {
+        const float values[9] = { 0, -amount, 0, -amount, 1 + 4 * amount, -amount, 0, -amount, 0 };
+        return ConvolutionKernel(3, 3, values);
+    }
+    // 边缘增强
+    static ConvolutionKernel EdgeEnhance() {
+        const float values[9] = { -1, -1, -1, -1, 9, -1, -1, -1, -1 };
+        return ConvolutionKernel(3, 3, values);
+    }
+    // 浮雕：左上亮、右下暗，平坦区域为中灰
+    static ConvolutionKernel Emboss() {
+        const float values[9] = { -2, -1, 0, -1, 1, 1, 0, 1, 2 };
+        return ConvolutionKernel(3, 3, values, 1.0f, 128.0f);
+    }
+    // (2 * radius + 1) 见方的均值
+    static ConvolutionKernel Box(int radius) {
+        int size = radius * 2 + 1;
+        std::vector<float> values((size_t)size * size, 1.0f);
+        return ConvolutionKernel(size, size, values.data(), (float)(size * size));
+    }
+};
+
+// 卷积按图块处理：每个图块连同四周的边缘一起拷进连续缓冲，缓冲在线程内复用、能留在缓存里
+const int CONVOLVE_TILE_WIDTH = 128;
+const int CONVOLVE_TILE_HEIGHT = 64;
+
+// 一维或二维核换算成 16 位定点数：权重乘以 2^shift，shift 取满足以下条件的最大值（不超过 14）：
+// 每个权重不超过 16 位，且输入最大为 maxInput 时 32 位累加不会溢出
+inline std::vector<short> QuantizeWeights(const float* values, int count, float maxInput, int& shift) {
+    float largest = 0.0f;
+    float total = 0.0f;
+    for (int i = 0; i < count; i++) {
+        largest = max(largest, fabsf(values[i]));
+        total += fabsf(values[i]);
+    }
+    shift = 14;
+    while (shift > 0 && (largest * (1 << shift) > 32767.0f || maxInput * total * (1 << shift) > 1073741824.0f)) {
+        shift--;
+    }
+    std::vector<short> quantized(count);
+    for (int i = 0; i < count; i++) {
+        float v = floorf(values[i] * (1 << shift) + 0.5f);
+        quantized[i] = (short)max(-32768.0f, min(32767.0f, v));
+    }
+    return quantized;
+}
+
+// 卷积的一个抽头：相对于输出像素的偏移（以缓冲元素计）和定点权重；两个抽头配成一对用 pmaddwd 一次算完
+struct ConvolveTapPair {
+    int offsetA;
+    int offsetB;
+    int weights;        // 低 16 位是 A 的权重，高 16 位是 B 的
+};
+
+inline std::vector<ConvolveTapPair> PairTaps(const std::vector<int>& offsets, const std::vector<short>& weights) {
+    std::vector<int> usedOffsets;
+    std::vector<short> usedWeights;
+    for (size_t i = 0; i < weights.size(); i++) {
+        if (weights[i] != 0) {
+            usedOffsets.push_back(offsets[i]);
+            usedWeights.push_back(weights[i]);
+        }
+    }
+    std::vector<ConvolveTapPair> pairs;
+    for (size_t i = 0; i < usedWeights.size(); i += 2) {
+        ConvolveTapPair pair;
+        pair.offsetA = usedOffsets[i];
+        // 抽头个数为奇数时最后一个和权重为 0 的自己配对
+        pair.offsetB = i + 1 < usedWeights.size() ? usedOffsets[i + 1] : usedOffsets[i];
+        WORD weightB = i + 1 < usedWeights.size() ? (WORD)usedWeights[i + 1] : 0;
+        pair.weights = (int)(((DWORD)weightB << 16) | (WORD)usedWeights[i]);
+        pairs.push_back(pair);
+    }
+    return pairs;
+}
+
+// 4 个像素（每个像素 4 个 16 位通道，lo 是前两个像素，hi 是后两个）的两个抽头乘加到 4 个 32 位累加器上
+inline void MultiplyAddPixels(__m128i* acc, __m128i aLo, __m128i aHi, __m128i bLo, __m128i bHi, __m128i weights) {
+    acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), weights));
+    acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), weights));
+    acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), weights));
+    acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), weights));
+}
+// 累加器加上 offset（舍入和偏移量）后右移 shift 位
+inline void ShiftSums(__m128i* acc, __m128i offset, int shift) {
+    __m128i count = _mm_cvtsi32_si128(shift);
+    for (int i = 0; i < 4; i++) {
+        acc[i] = _mm_sra_epi32(_mm_add_epi32(acc[i], offset), count);
+    }
+}
+
+// 对 8 位像素缓冲 src 按 pairs 卷积 count 个像素（按 4 个一组计算，count 之后的缓冲也必须可读写）
+// 结果为 8 位像素时写入 out8，为 16 位中间结果时写入 out16
+inline void ConvolvePixels8(const _RGBQUAD* src, int count, const std::vector<ConvolveTapPair>& pairs, __m128i offset, int shift, PRGBQUAD out8, short* out16) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < count; x += 4) {
+        __m128i acc[4] = { zero, zero, zero, zero };
+        for (size_t k = 0; k < pairs.size(); k++) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(src + x + pairs[k].offsetA));
+            __m128i b = _mm_loadu_si128((const __m128i*)(src + x + pairs[k].offsetB));
+            MultiplyAddPixels(acc, _mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero),
+                _mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero), _mm_set1_epi32(pairs[k].weights));
+        }
+        ShiftSums(acc, offset, shift);
+        __m128i lo = _mm_packs_epi32(acc[0], acc[1]);
+        __m128i hi = _mm_packs_epi32(acc[2], acc[3]);
+        if (out8 != NULL) {
+            _mm_storeu_si128((__m128i*)(out8 + x), _mm_packus_epi16(lo, hi));
+        }
+        else {
+            _mm_storeu_si128((__m128i*)(out16 + x * 4), lo);
+            _mm_storeu_si128((__m128i*)(out16 + x * 4 + 8), hi);
+        }
+    }
+}
+// 对 16 位中间结果缓冲卷积 count 个像素，结果为 8 位像素
+inline void ConvolvePixels16(const short* src, int count, const std::vector<ConvolveTapPair>& pairs, __m128i offset, int shift, PRGBQUAD out) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < count; x += 4) {
+        __m128i acc[4] = { zero, zero, zero, zero };
+        for (size_t k = 0; k < pairs.size(); k++) {
+            const short* a = src + (ptrdiff_t)(x + pairs[k].offsetA) * 4;
+            const short* b = src + (ptrdiff_t)(x + pairs[k].offsetB) * 4;
+            MultiplyAddPixels(acc, _mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)(a + 8)),
+                _mm_loadu_si128((const __m128i*)b), _mm_loadu_si128((const __m128i*)(b + 8)), _mm_set1_epi32(pairs[k].weights));
+        }
+        ShiftSums(acc, offset, shift);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(_mm_packs_epi32(acc[0], acc[1]), _mm_packs_epi32(acc[2], acc[3])));
+    }
+}
+
+// 把 source 上 [x0, x0 + w) x [y0, y0 + h) 连同四周 padX / padY 像素拷进 tile（每行 stride 个像素）
+// 超出表面的部分取最近的边缘像素，之后的卷积循环里就不用判断边界
+inline void LoadConvolveTile(const Surface& source, int x0, int y0, int w, int h, int padX, int padY, int stride, std::vector<_RGBQUAD>& tile) {
+    tile.resize((size_t)stride * (h + padY * 2) + 4);
+    int left = x0 - padX;
+    int right = x0 + w + padX;
+    int copyBegin = max(0, left);
+    int copyEnd = min(source.width, right);
+    for (int r = 0; r < h + padY * 2; r++) {
+        const _RGBQUAD* row = source.Row(max(0, min(source.height - 1, y0 - padY + r)));
+        PRGBQUAD dst = &tile[(size_t)r * stride];
+        int i = 0;
+        for (; i < copyBegin - left; i++) {
+            dst[i] = row[0];
+        }
+        memcpy(dst + i, row + copyBegin, (copyEnd - copyBegin) * sizeof(_RGBQUAD));
+        for (i += copyEnd - copyBegin; i < stride; i++) {
+            dst[i] = row[source.width - 1];
+        }
+    }
+}
+
+// 卷积：结果写到和 source 一样大的 target 上（两者不能是同一块像素）
+// 可分离的核拆成水平、竖直两遍一维卷积，水平一遍的结果以 16 位定点数留在图块缓冲里
+inline void Convolve(const Surface& source, Surface& target, const ConvolutionKernel& kernel) {
+    if (source.Empty() || target.Empty() || source.width != target.width || source.height != target.height) {
+        return;
+    }
+    int rx = kernel.width / 2;
+    int ry = kernel.height / 2;
+    int tilesX = (source.width + CONVOLVE_TILE_WIDTH - 1) / CONVOLVE_TILE_WIDTH;
+    int tilesY = (source.height + CONVOLVE_TILE_HEIGHT - 1) / CONVOLVE_TILE_HEIGHT;
+    // 图块缓冲的行宽：输出宽度补齐到 4 的倍数，加上两边的边缘
+    int stride = ((CONVOLVE_TILE_WIDTH + 3) & ~3) + rx * 2;
+
+    std::vector<float> column, row;
+    if (kernel.IsSeparable(column, row)) {
+        // 中间结果保留 interShift 位小数，并保证不超过 16 位
+        float rowTotal = 0.0f;
+        for (int i = 0; i < kernel.width; i++) {
+            rowTotal += fabsf(row[i]);
+        }
+        int rowShift, columnShift;
+        std::vector<short> rowWeights = QuantizeWeights(row.data(), kernel.width, 255.0f, rowShift);
+        std::vector<short> columnWeights = QuantizeWeights(column.data(), kernel.height, 32767.0f, columnShift);
+        int interShift = 0;
+        while (interShift < min(6, rowShift) && 255.0f * rowTotal * (2 << interShift) <= 32767.0f) {
+            interShift++;
+        }
+        int interStride = stride - rx * 2;
+        std::vector<int> rowOffsets(kernel.width), columnOffsets(kernel.height);
+        for (int i = 0; i < kernel.width; i++) {
+            rowOffsets[i] = i;
+        }
+        for (int i = 0; i < kernel.height; i++) {
+            columnOffsets[i] = i * interStride;
+        }
+        std::vector<ConvolveTapPair> rowPairs = PairTaps(rowOffsets, rowWeights);
+        std::vector<ConvolveTapPair> columnPairs = PairTaps(columnOffsets, columnWeights);
+        int rowDown = rowShift - interShift;
+        int columnDown = columnShift + interShift;
+        __m128i rowOffset = _mm_set1_epi32(rowDown > 0 ? 1 << (rowDown - 1) : 0);
+        __m128i columnOffset = _mm_set1_epi32((int)floorf(kernel.bias * (1 << columnDown) + 0.5f) + (columnDown > 0 ? 1 << (columnDown - 1) : 0));
+
+        ParallelFor(tilesX * tilesY, [&](int begin, int end) {
+            std::vector<_RGBQUAD> tile;
+            std::vector<short> inter((size_t)interStride * (CONVOLVE_TILE_HEIGHT + ry * 2) * 4 + 16);
+            std::vector<_RGBQUAD> out(interStride);
+            for (int t = begin; t < end; t++) {
+                int x0 = t % tilesX * CONVOLVE_TILE_WIDTH;
+                int y0 = t / tilesX * CONVOLVE_TILE_HEIGHT;
+                int w = min(CONVOLVE_TILE_WIDTH, source.width - x0);
+                int h = min(CONVOLVE_TILE_HEIGHT, source.height - y0);
+                LoadConvolveTile(source, x0, y0, w, h, rx, ry, stride, tile);
+                for (int r = 0; r < h + ry * 2; r++) {
+                    ConvolvePixels8(&tile[(size_t)r * stride], w, rowPairs, rowOffset, rowDown, NULL, &inter[(size_t)r * interStride * 4]);
+                }
+                for (int r = 0; r < h; r++) {
+                    ConvolvePixels16(&inter[(size_t)r * interStride * 4], w, columnPairs, columnOffset, columnDown, out.data());
+                    memcpy(target.Row(y0 + r) + x0, out.data(), w * sizeof(_RGBQUAD));
+                }
+            }
+        }, 1);
+        return;
+    }
+
+    int shift;
+    std::vector<short> weights = QuantizeWeights(kernel.weights.data(), (int)kernel.weights.size(), 255.0f, shift);
+    std::vector<int> offsets(kernel.weights.size());
+    for (int y = 0; y < kernel.height; y++) {
+        for (int x = 0; x < kernel.width; x++) {
+            offsets[(size_t)y * kernel.width + x] = y * stride + x;
+        }
+    }
+    std::vector<ConvolveTapPair> pairs = PairTaps(offsets, weights);
+    __m128i offset = _mm_set1_epi32((int)floorf(kernel.bias * (1 << shift) + 0.5f) + (shift > 0 ? 1 << (shift - 1) : 0));
+
+    ParallelFor(tilesX * tilesY, [&](int begin, int end) {
+        std::vector<_RGBQUAD> tile;
+        std::vector<_RGBQUAD> out(stride);
+        for (int t = begin; t < end; t++) {
+            int x0 = t % tilesX * CONVOLVE_TILE_WIDTH;
+            int y0 = t / tilesX * CONVOLVE_TILE_HEIGHT;
+            int w = min(CONVOLVE_TILE_WIDTH, source.width - x0);
+            int h = min(CONVOLVE_TILE_HEIGHT, source.height - y0);
+            LoadConvolveTile(source, x0, y0, w, h, rx, ry, stride, tile);
+            for (int r = 0; r < h; r++) {
+                ConvolvePixels8(&tile[(size_t)r * stride], w, pairs, offset, shift, out.data(), NULL);
+                memcpy(target.Row(y0 + r) + x0, out.data(), w * sizeof(_RGBQUAD));
+            }
+        }
+    }, 1);
+}
+
+// 原地卷积：先把原图拷一份作为输入
+inline void Convolve(Surface& surface, const ConvolutionKernel& kernel) {
+    if (surface.Empty()) {
+        return;
+    }
+    std::vector<_RGBQUAD> copy(surface.pixels, surface.pixels + (size_t)surface.width * surface.height);
+    Surface source(copy.data(), surface.width, surface.height);
+    Convolve(source, surface, kernel);
+}
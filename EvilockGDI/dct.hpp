@@ -0,0 +1,279 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// JPEG 式的压缩失真：画面切成 8x8 块，转成 YCbCr 后每块做 DCT，系数按量化表量化（可以再随机破坏），
+// 反变换回来，就有了块状、振铃、色彩渗色这些低质量 JPEG 的痕迹；每一行块分给一个线程
+
+// 8x8 DCT 的两个变换矩阵：forward[k][n] = c(k) cos((2n+1)kπ/16)，inverse 是它的转置（正交矩阵）
+struct DCTMatrices {
+    float forward[64];
+    float inverse[64];
+    DCTMatrices() {
+        for (int k = 0; k < 8; k++) {
+            for (int n = 0; n < 8; n++) {
+                float c = k == 0 ? sqrtf(0.125f) : 0.5f;
+                forward[k * 8 + n] = c * cosf((2 * n + 1) * k * 3.14159265f / 16.0f);
+                inverse[n * 8 + k] = forward[k * 8 + n];
+            }
+        }
+    }
+};
+inline const DCTMatrices& GetDCTMatrices() {
+    static const DCTMatrices matrices;
+    return matrices;
+}
+
+// out = m * in * m^T：先算 in * m^T（第 i 行是 in[i][j] 乘 m^T 第 j 行之和），再左乘 m（第 k 行是 m[k][i] 乘上一步第 i 行之和）
+// 每一行是两个 __m128，两步都是“标量广播乘行向量再累加”，不需要转置；mt 是 m 的转置
+inline void Transform8x8(const float* in, float* out, const float* m, const float* mt) {
+    __m128 temp[16];
+    for (int i = 0; i < 8; i++) {
+        __m128 lo = _mm_setzero_ps();
+        __m128 hi = _mm_setzero_ps();
+        for (int j = 0; j < 8; j++) {
+            __m128 v = _mm_set1_ps(in[i * 8 + j]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(v, _mm_loadu_ps(mt + j * 8)));
+            hi = _mm_add_ps(hi, _mm_mul_ps(v, _mm_loadu_ps(mt + j * 8 + 4)));
+        }
+        temp[i * 2] = lo;
+        temp[i * 2 + 1] = hi;
+    }
+    for (int k = 0; k < 8; k++) {
+        __m128 lo = _mm_setzero_ps();
+        __m128 hi = _mm_setzero_ps();
+        for (int i = 0; i < 8; i++) {
+            __m128 v = _mm_set1_ps(m[k * 8 + i]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(v, temp[i * 2]));
+            hi = _mm_add_ps(hi, _mm_mul_ps(v, temp[i * 2 + 1]));
+        }
+        _mm_storeu_ps(out + k * 8, lo);
+        _mm_storeu_ps(out + k * 8 + 4, hi);
+    }
+}
+
+inline void ForwardDCT8x8(const float* in, float* out) {
+    const DCTMatrices& m = GetDCTMatrices();
+    Transform8x8(in, out, m.forward, m.inverse);
+}
+inline void InverseDCT8x8(const float* in, float* out) {
+    const DCTMatrices& m = GetDCTMatrices();
+    Transform8x8(in, out, m.inverse, m.forward);
+}
+
+// JPEG 标准（附录 K）的亮度 / 色度量化表
+const BYTE JPEG_LUMA_TABLE[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+const BYTE JPEG_CHROMA_TABLE[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// 按 libjpeg 的方式把质量（1～100）换算成量化步长
+inline void ScaleQuantTable(const BYTE* base, int quality, float* steps) {
+    quality = max(1, min(100, quality));
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int i = 0; i < 64; i++) {
+        steps[i] = (float)max(1, min(255, (base[i] * scale + 50) / 100));
+    }
+}
+
+// 简单的整数哈希，块的随机数只由种子和块坐标决定，和线程划分无关
+inline DWORD BlockHash(DWORD seed, int bx, int by) {
+    DWORD h = seed ^ (DWORD)bx * 0x9E3779B1u ^ (DWORD)by * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+// 量化 coefficients 后再反量化；broken 为 true 时随机放大或取反交流系数（直流不动，块的平均色不变）
+inline void QuantizeBlock(float* coefficients, const float* steps, bool broken, DWORD& random) {
+    int levels[64];
+    for (int i = 0; i < 64; i += 4) {
+        __m128 s = _mm_loadu_ps(steps + i);
+        __m128i q = _mm_cvtps_epi32(_mm_div_ps(_mm_loadu_ps(coefficients + i), s));
+        _mm_storeu_si128((__m128i*)(levels + i), q);
+    }
+    if (broken) {
+        for (int i = 1; i < 64; i++) {
+            random = random * 1664525u + 1013904223u;
+            int r = (int)(random >> 28);
+            if (r < 4) {
+                levels[i] = -levels[i] * (r + 1);
+            }
+            else if (r < 6) {
+                levels[i] += r == 4 ? 1 : -1;
+            }
+        }
+    }
+    for (int i = 0; i < 64; i += 4) {
+        __m128 q = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(levels + i)));
+        _mm_storeu_ps(coefficients + i, _mm_mul_ps(q, _mm_loadu_ps(steps + i)));
+    }
+}
+
+// JPEG 压缩失真：quality 为 1～100（越低块越明显），corruption 为每个块被随机破坏的概率（0～1）
+// 亮度用亮度量化表，Cb、Cr 用更粗的色度量化表（没有做色度抽样）；右 / 下边缘不足 8 的块按边缘像素补齐后处理
+inline void ApplyDCTArtifacts(Surface& surface, int quality, float corruption = 0.0f, DWORD seed = 0) {
+    if (surface.Empty()) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    float lumaSteps[64], chromaSteps[64];
+    ScaleQuantTable(JPEG_LUMA_TABLE, quality, lumaSteps);
+    ScaleQuantTable(JPEG_CHROMA_TABLE, quality, chromaSteps);
+    DWORD threshold = (DWORD)(max(0.0f, min(1.0f, corruption)) * 4294967295.0);
+    int blockRows = (h + 7) / 8;
+    ParallelFor(blockRows, [&surface, &lumaSteps, &chromaSteps, w, h, threshold, corruption, seed](int begin, int end) {
+        const __m128i byteMask = _mm_set1_epi32(0xFF);
+        float planes[3][64], coefficients[64];
+        for (int by = begin; by < end; by++) {
+            for (int bx = 0; bx < (w + 7) / 8; bx++) {
+                int x0 = bx * 8;
+                int y0 = by * 8;
+                // 取出 8x8 像素（越界的行列重复边缘），转成减去 128 的 Y、Cb、Cr
+                for (int i = 0; i < 8; i++) {
+                    const _RGBQUAD* row = surface.Row(min(y0 + i, h - 1));
+                    _RGBQUAD pixels[8];
+                    for (int j = 0; j < 8; j++) {
+                        pixels[j] = row[min(x0 + j, w - 1)];
+                    }
+                    for (int half = 0; half < 2; half++) {
+                        __m128i p = _mm_loadu_si128((const __m128i*)(pixels + half * 4));
+                        __m128 b = _mm_cvtepi32_ps(_mm_and_si128(p, byteMask));
+                        __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 8), byteMask));
+                        __m128 r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask));
+                        __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.299f)), _mm_mul_ps(g, _mm_set1_ps(0.587f))), _mm_mul_ps(b, _mm_set1_ps(0.114f)));
+                        __m128 cb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(-0.168736f)), _mm_mul_ps(g, _mm_set1_ps(-0.331264f))), _mm_mul_ps(b, _mm_set1_ps(0.5f)));
+                        __m128 cr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.5f)), _mm_mul_ps(g, _mm_set1_ps(-0.418688f))), _mm_mul_ps(b, _mm_set1_ps(-0.081312f)));
+                        _mm_storeu_ps(planes[0] + i * 8 + half * 4, _mm_sub_ps(y, _mm_set1_ps(128.0f)));
+                        _mm_storeu_ps(planes[1] + i * 8 + half * 4, cb);
+                        _mm_storeu_ps(planes[2] + i * 8 + half * 4, cr);
+                    }
+                }
+                DWORD random = BlockHash(seed, bx, by);
+                bool broken = corruption > 0.0f && random <= threshold;
+                for (int c = 0; c < 3; c++) {
+                    ForwardDCT8x8(planes[c], coefficients);
+                    QuantizeBlock(coefficients, c == 0 ? lumaSteps : chromaSteps, broken, random);
+                    InverseDCT8x8(coefficients, planes[c]);
+                }
+                // 转回 RGB，packs / packus 顺便把结果限制在 0～255，alpha 保留原值
+                int rows = min(8, h - y0);
+                int columns = min(8, w - x0);
+                for (int i = 0; i < rows; i++) {
+                    PRGBQUAD row = surface.Row(y0 + i);
+                    _RGBQUAD pixels[8];
+                    for (int half = 0; half < 2; half++) {
+                        __m128 y = _mm_add_ps(_mm_loadu_ps(planes[0] + i * 8 + half * 4), _mm_set1_ps(128.0f));
+                        __m128 cb = _mm_loadu_ps(planes[1] + i * 8 + half * 4);
+                        __m128 cr = _mm_loadu_ps(planes[2] + i * 8 + half * 4);
+                        __m128i r = _mm_cvtps_epi32(_mm_add_ps(y, _mm_mul_ps(cr, _mm_set1_ps(1.402f))));
+                        __m128i g = _mm_cvtps_epi32(_mm_sub_ps(y, _mm_add_ps(_mm_mul_ps(cb, _mm_set1_ps(0.344136f)), _mm_mul_ps(cr, _mm_set1_ps(0.714136f)))));
+                        __m128i b = _mm_cvtps_epi32(_mm_add_ps(y, _mm_mul_ps(cb, _mm_set1_ps(1.772f))));
+                        // 打包成 b0..b3 g0..g3 r0..r3 0..0，再交错成 b g r 0 的像素顺序
+                        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(b, g), _mm_packs_epi32(r, _mm_setzero_si128()));
+                        __m128i bg = _mm_unpacklo_epi8(bytes, _mm_srli_si128(bytes, 4));
+                        __m128i ra = _mm_unpacklo_epi8(_mm_srli_si128(bytes, 8), _mm_srli_si128(bytes, 12));
+                        _mm_storeu_si128((__m128i*)(pixels + half * 4), _mm_unpacklo_epi16(bg, ra));
+                    }
+                    for (int j = 0; j < columns; j++) {
+                        row[x0 + j].rgb = (pixels[j].rgb & 0x00FFFFFF) | (row[x0 + j].rgb & 0xFF000000);
+                    }
+                }
+            }
+        }
+    }, 1);
+}
+
+// 数据损坏（datamosh）用的宏块大小和运动搜索范围
+const int MOSH_BLOCK = 16;
+const int MOSH_SEARCH = 7;
+
+// 当前帧一个宏块和上一帧 (px, py) 处同样大小区域的绝对差之和，psadbw 每次比较 4 个像素
+inline DWORD BlockSAD(const Surface& current, int x0, int y0, const Surface& previous, int px, int py) {
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < MOSH_BLOCK; i++) {
+        const _RGBQUAD* a = current.Row(y0 + i) + x0;
+        const _RGBQUAD* b = previous.Row(py + i) + px;
+        for (int j = 0; j < MOSH_BLOCK; j += 4) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + j));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+        }
+    }
+    return (DWORD)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+
+// 数据损坏：模仿丢了关键帧、只剩运动矢量的视频流 —— 每个 16x16 宏块在上一帧里找最像的位置（三步搜索），
+// 以 amount 的概率把当前块换成上一帧那个位置的像素（即只做运动补偿、丢掉残差），画面内容会拖着旧帧的像素移动
+// previous 尺寸和 frame 不同时什么也不做；不足一个宏块的边缘保持原样
+inline void Datamosh(Surface& frame, const Surface& previous, float amount = 1.0f, DWORD seed = 0) {
+    if (frame.Empty() || previous.width != frame.width || previous.height != frame.height) {
+        return;
+    }
+    int w = frame.width;
+    int h = frame.height;
+    int blocksX = w / MOSH_BLOCK;
+    int blocksY = h / MOSH_BLOCK;
+    DWORD threshold = (DWORD)(max(0.0f, min(1.0f, amount)) * 4294967295.0);
+    ParallelFor(blocksY, [&frame, &previous, w, h, blocksX, threshold, seed](int begin, int end) {
+        for (int by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                if (BlockHash(seed, bx, by) > threshold) {
+                    continue;
+                }
+                int x0 = bx * MOSH_BLOCK;
+                int y0 = by * MOSH_BLOCK;
+                int bestX = x0, bestY = y0;
+                DWORD best = BlockSAD(frame, x0, y0, previous, x0, y0);
+                // 三步搜索：步长 4、2、1，每一步在当前最优点周围 8 个位置里找更好的
+                for (int stride = (MOSH_SEARCH + 1) / 2; stride >= 1; stride /= 2) {
+                    int centerX = bestX, centerY = bestY;
+                    for (int dy = -stride; dy <= stride; dy += stride) {
+                        for (int dx = -stride; dx <= stride; dx += stride) {
+                            int px = centerX + dx;
+                            int py = centerY + dy;
+                            if ((dx == 0 && dy == 0) || px < 0 || py < 0 || px + MOSH_BLOCK > w || py + MOSH_BLOCK > h ||
+                                abs(px - x0) > MOSH_SEARCH || abs(py - y0) > MOSH_SEARCH) {
+                                continue;
+                            }
+                            DWORD sad = BlockSAD(frame, x0, y0, previous, px, py);
+                            if (sad < best) {
+                                best = sad;
+                                bestX = px;
+                                bestY = py;
+                            }
+                        }
+                    }
+                }
+                for (int i = 0; i < MOSH_BLOCK; i++) {
+                    memcpy(frame.Row(y0 + i) + x0, previous.Row(bestY + i) + bestX, MOSH_BLOCK * sizeof(_RGBQUAD));
+                }
+            }
+        }
+    }, 1);
+}
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "transpose.hpp"
+
+// 整行 / 整列位移：波浪、错切、故障抖动之类的效果每一行（列）只有一个偏移量，
+// 偏移量数组每帧按曲线算一次，然后每行只需要一两次整段拷贝，不必逐像素计算坐标
+
+// 按正弦曲线生成 count 个偏移量：offsets[i] = amplitude * sin(2π * i / period + phase)
+inline void SineOffsets(std::vector<int>& offsets, int count, float amplitude, float period, float phase = 0.0f) {
+    offsets.resize(max(0, count));
+    float step = period != 0.0f ? 6.2831853f / period : 0.0f;
+    for (int i = 0; i < count; i++) {
+        offsets[i] = (int)floorf(amplitude * sinf(i * step + phase) + 0.5f);
+    }
+}
+
+// dst[x] = src[x - shift]（shift > 0 时向右移）；wrap 为 true 时移出的部分从另一端绕回，否则空出的部分重复边缘像素
+// dst 和 src 不能重叠
+inline void ShiftSpan(PRGBQUAD dst, const _RGBQUAD* src, int count, int shift, bool wrap) {
+    if (count <= 0) {
+        return;
+    }
+    if (wrap) {
+        shift %= count;
+        if (shift < 0) {
+            shift += count;
+        }
+        memcpy(dst + shift, src, (count - shift) * sizeof(_RGBQUAD));
+        memcpy(dst, src + count - shift, shift * sizeof(_RGBQUAD));
+    }
+    else if (shift >= 0) {
+        shift = min(shift, count);
+        memcpy(dst + shift, src, (count - shift) * sizeof(_RGBQUAD));
+        FillSpan(dst, src[0].rgb, shift);
+    }
+    else {
+        shift = min(-shift, count);
+        memcpy(dst, src + shift, (count - shift) * sizeof(_RGBQUAD));
+        FillSpan(dst + count - shift, src[count - 1].rgb, shift);
+    }
+}
+
+// 原地移动一行：先用 scratch 保存会被覆盖的那一头（最多 |shift| 个像素），再整段 memmove
+inline void ShiftSpanInPlace(PRGBQUAD line, int count, int shift, bool wrap, std::vector<_RGBQUAD>& scratch) {
+    if (count <= 0) {
+        return;
+    }
+    if (wrap) {
+        shift %= count;
+        if (shift < 0) {
+            shift += count;
+        }
+        // 右移 shift 和左移 count - shift 等价，挑需要暂存像素少的方向
+        if (shift > count / 2) {
+            shift -= count;
+        }
+    }
+    else {
+        shift = max(-count, min(count, shift));
+    }
+    if (shift == 0) {
+        return;
+    }
+    int n = shift > 0 ? shift : -shift;
+    if (wrap) {
+        scratch.resize(n);
+        if (shift > 0) {
+            memcpy(scratch.data(), line + count - n, n * sizeof(_RGBQUAD));
+            memmove(line + n, line, (count - n) * sizeof(_RGBQUAD));
+            memcpy(line, scratch.data(), n * sizeof(_RGBQUAD));
+        }
+        else {
+            memcpy(scratch.data(), line, n * sizeof(_RGBQUAD));
+            memmove(line, line + n, (count - n) * sizeof(_RGBQUAD));
+            memcpy(line + count - n, scratch.data(), n * sizeof(_RGBQUAD));
+        }
+    }
+    else if (shift > 0) {
+        DWORD edge = line[0].rgb;
+        memmove(line + n, line, (count - n) * sizeof(_RGBQUAD));
+        FillSpan(line, edge, n);
+    }
+    else {
+        DWORD edge = line[count - 1].rgb;
+        memmove(line, line + n, (count - n) * sizeof(_RGBQUAD));
+        FillSpan(line + count - n, edge, n);
+    }
+}
+
+// 第 y 行向右移动 offsets[y] 个像素（负数向左），结果写到 target，每行就是一次拷贝
+// target 的尺寸和 source 不同时重新创建
+inline void DisplaceRows(const Surface& source, Surface& target, const int* offsets, bool wrap = true) {
+    if (source.Empty()) {
+        return;
+    }
+    if (target.width != source.width || target.height != source.height) {
+        target.Create(source.width, source.height);
+    }
+    ParallelFor(source.height, [&source, &target, offsets, wrap](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            ShiftSpan(target.Row(y), source.Row(y), source.width, offsets[y], wrap);
+        }
+    }, 32);
+}
+
+// 原地版本
+inline void DisplaceRows(Surface& surface, const int* offsets, bool wrap = true) {
+    ParallelFor(surface.height, [&surface, offsets, wrap](int begin, int end) {
+        std::vector<_RGBQUAD> scratch;
+        for (int y = begin; y < end; y++) {
+            ShiftSpanInPlace(surface.Row(y), surface.width, offsets[y], wrap, scratch);
+        }
+    }, 32);
+}
+
+// 第 x 列向下移动 offsets[x] 个像素（负数向上），列带转置成行后处理（见 ShiftColumns）
+inline void DisplaceColumns(Surface& surface, const int* offsets, bool wrap = true) {
+    ShiftColumns(surface, [offsets](int x) {
+        return offsets[x];
+    }, wrap);
+}
+
+// 只把 mask 选中的字节从 src 拷到 dst
+inline void MaskedCopySpan(PRGBQUAD dst, const _RGBQUAD* src, DWORD mask, int count) {
+    const __m128i keep = _mm_set1_epi32((int)mask);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_andnot_si128(keep, d), _mm_and_si128(keep, s)));
+    }
+    for (; i < count; i++) {
+        dst[i].rgb = (dst[i].rgb & ~mask) | (src[i].rgb & mask);
+    }
+}
+
+// 分通道位移（RGB 分离）：第 y 行的 b、g、r 通道分别向右移动 blue[y]、green[y]、red[y] 个像素，alpha 不动
+// 某个通道的数组为 NULL 时这个通道不移动；每行先整段移位到临时行，再按通道掩码合并回来
+inline void DisplaceChannels(Surface& surface, const int* blue, const int* green, const int* red, bool wrap = true) {
+    const int* offsets[3] = { blue, green, red };
+    ParallelFor(surface.height, [&surface, offsets, wrap](int begin, int end) {
+        int w = surface.width;
+        std::vector<_RGBQUAD> original(w);
+        std::vector<_RGBQUAD> shifted(w);
+        for (int y = begin; y < end; y++) {
+            PRGBQUAD row = surface.Row(y);
+            bool copied = false;
+            for (int c = 0; c < 3; c++) {
+                if (offsets[c] == NULL || offsets[c][y] == 0) {
+                    continue;
+                }
+                if (!copied) {
+                    memcpy(original.data(), row, w * sizeof(_RGBQUAD));
+                    copied = true;
+                }
+                ShiftSpan(shifted.data(), original.data(), w, offsets[c][y], wrap);
+                MaskedCopySpan(row, shifted.data(), 0xFFu << (c * 8), w);
+            }
+        }
+    }, 32);
+}
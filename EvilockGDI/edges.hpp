@@ -0,0 +1,176 @@
+﻿#pragma once
+#include <Windows.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 边缘检测算子：3x3 的 Sobel（权重 1 2 1）或旋转对称性更好的 Scharr（权重 3 10 3）
+enum EdgeOperator {
+    EDGE_SOBEL,
+    EDGE_SCHARR
+};
+
+// 一行像素转成亮度 (29b + 150g + 77r) >> 8，写到 luma[1]～luma[width]，
+// 左边补一个、右边补到 padded 个边缘值，算梯度时不用判断边界
+inline void LumaRow(const _RGBQUAD* row, int width, short* luma, int padded) {
+    const __m128i weights = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(128);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(row + x));
+        // 每个像素得到 29b + 150g 和 77r 两个部分和，再把相邻的两个加起来
+        __m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(p, zero), weights));
+        __m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(p, zero), weights));
+        __m128i sum = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))));
+        sum = _mm_srli_epi32(_mm_add_epi32(sum, round), 8);
+        _mm_storel_epi64((__m128i*)(luma + 1 + x), _mm_packs_epi32(sum, sum));
+    }
+    for (; x < width; x++) {
+        luma[1 + x] = (short)((row[x].b * 29 + row[x].g * 150 + row[x].r * 77 + 128) >> 8);
+    }
+    luma[0] = luma[1];
+    for (x = width + 1; x < padded; x++) {
+        luma[x] = luma[width];
+    }
+}
+
+// 由上、中、下三行亮度算出一行的水平 / 竖直梯度和梯度大小，每次 8 个像素
+// 梯度大小乘以 scale 后存成 16 位整数；count 要补齐到 8 的倍数
+inline void GradientRow(const short* up, const short* center, const short* down, int count, short side, short middle, float scale, short* gx, short* gy, short* magnitude) {
+    const __m128i a = _mm_set1_epi16(side);
+    const __m128i b = _mm_set1_epi16(middle);
+    const __m128 factor = _mm_set1_ps(scale);
+    for (int x = 0; x < count; x += 8) {
+        __m128i upL = _mm_loadu_si128((const __m128i*)(up + x));
+        __m128i upC = _mm_loadu_si128((const __m128i*)(up + x + 1));
+        __m128i upR = _mm_loadu_si128((const __m128i*)(up + x + 2));
+        __m128i cL = _mm_loadu_si128((const __m128i*)(center + x));
+        __m128i cR = _mm_loadu_si128((const __m128i*)(center + x + 2));
+        __m128i downL = _mm_loadu_si128((const __m128i*)(down + x));
+        __m128i downC = _mm_loadu_si128((const __m128i*)(down + x + 1));
+        __m128i downR = _mm_loadu_si128((const __m128i*)(down + x + 2));
+        __m128i dx = _mm_add_epi16(_mm_mullo_epi16(a, _mm_add_epi16(_mm_sub_epi16(upR, upL), _mm_sub_epi16(downR, downL))),
+            _mm_mullo_epi16(b, _mm_sub_epi16(cR, cL)));
+        __m128i dy = _mm_add_epi16(_mm_mullo_epi16(a, _mm_add_epi16(_mm_sub_epi16(downL, upL), _mm_sub_epi16(downR, upR))),
+            _mm_mullo_epi16(b, _mm_sub_epi16(downC, upC)));
+        _mm_storeu_si128((__m128i*)(gx + x), dx);
+        _mm_storeu_si128((__m128i*)(gy + x), dy);
+        // gx 和 gy 交错排列后和自己做 pmaddwd，正好得到 gx^2 + gy^2
+        __m128i lo = _mm_unpacklo_epi16(dx, dy);
+        __m128i hi = _mm_unpackhi_epi16(dx, dy);
+        __m128 magLo = _mm_mul_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))), factor);
+        __m128 magHi = _mm_mul_ps(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))), factor);
+        _mm_storeu_si128((__m128i*)(magnitude + x), _mm_packs_epi32(_mm_cvtps_epi32(magLo), _mm_cvtps_epi32(magHi)));
+    }
+}
+
+// 边缘检测：亮度转换、梯度和梯度大小在同一遍里按行带算完（每个线程只保留几行亮度和梯度），不生成整幅灰度图
+// mask 的第 y 行从 mask + y * stride 开始，写入 0～255 的边缘强度；gain 放大弱边缘
+// thin 为 true 时做非极大值抑制：只保留沿梯度方向上比两侧都强的像素，边缘细到一个像素宽
+inline void DetectEdges(const Surface& source, BYTE* mask, int stride, EdgeOperator op = EDGE_SOBEL, bool thin = false, float gain = 1.0f) {
+    if (source.Empty()) {
+        return;
+    }
+    int w = source.width;
+    int h = source.height;
+    short side = op == EDGE_SCHARR ? 3 : 1;
+    short middle = op == EDGE_SCHARR ? 10 : 2;
+    // 除以一侧权重之和，让一条 0→255 的硬边的强度正好是 255
+    float scale = gain / (side * 2 + middle);
+    int count = (w + 7) & ~7;
+    int padded = count + 10;
+    ParallelFor(h, [&source, mask, stride, w, h, side, middle, scale, count, padded, thin](int begin, int end) {
+        // 亮度按行号放在 4 行的环形缓冲里，梯度放在 3 行的环形缓冲里，每行只算一次
+        std::vector<short> luma((size_t)padded * 4);
+        std::vector<short> gradient((size_t)count * 3 * 3);
+        int lumaRows[4] = { INT_MIN, INT_MIN, INT_MIN, INT_MIN };
+        int gradientRows[3] = { INT_MIN, INT_MIN, INT_MIN };
+        auto lumaRow = [&](int y) -> const short* {
+            int slot = (y + 4) & 3;
+            short* row = &luma[(size_t)slot * padded];
+            if (lumaRows[slot] != y) {
+                LumaRow(source.Row(max(0, min(h - 1, y))), w, row, padded);
+                lumaRows[slot] = y;
+            }
+            return row;
+        };
+        // 返回第 y 行的 gx，gy 和梯度大小依次跟在后面，各 count 个
+        auto gradientRow = [&](int y) -> const short* {
+            y = max(0, min(h - 1, y));
+            int slot = y % 3;
+            short* row = &gradient[(size_t)slot * count * 3];
+            if (gradientRows[slot] != y) {
+                GradientRow(lumaRow(y - 1), lumaRow(y), lumaRow(y + 1), count, side, middle, scale, row, row + count, row + count * 2);
+                gradientRows[slot] = y;
+            }
+            return row;
+        };
+        for (int y = begin; y < end; y++) {
+            BYTE* out = mask + (size_t)y * stride;
+            if (!thin) {
+                const short* magnitude = gradientRow(y) + count * 2;
+                for (int x = 0; x < w; x++) {
+                    out[x] = (BYTE)min((int)magnitude[x], 255);
+                }
+                continue;
+            }
+            const short* up = gradientRow(y - 1) + count * 2;
+            const short* down = gradientRow(y + 1) + count * 2;
+            const short* center = gradientRow(y);
+            const short* gx = center;
+            const short* gy = center + count;
+            const short* magnitude = center + count * 2;
+            for (int x = 0; x < w; x++) {
+                int m = magnitude[x];
+                if (m == 0) {
+                    out[x] = 0;
+                    continue;
+                }
+                int left = max(0, x - 1);
+                int right = min(w - 1, x + 1);
+                // 梯度方向按 22.5° / 67.5°（tan 约为 0.414 / 2.414）分成水平、竖直和两条对角线，比较方向上的两个邻居
+                int ax = abs(gx[x]);
+                int ay = abs(gy[x]);
+                int before, after;
+                if (ay * 1000 <= ax * 414) {
+                    before = magnitude[left];
+                    after = magnitude[right];
+                }
+                else if (ay * 1000 >= ax * 2414) {
+                    before = up[x];
+                    after = down[x];
+                }
+                else if ((gx[x] ^ gy[x]) >= 0) {
+                    before = up[left];
+                    after = down[right];
+                }
+                else {
+                    before = up[right];
+                    after = down[left];
+                }
+                out[x] = m > before && m >= after ? (BYTE)min(m, 255) : 0;
+            }
+        }
+    }, 16);
+}
+
+// 把边缘用 color 叠加到表面上，强度就是边缘检测的结果（乘以 alpha / 255），可以做描边和边缘发光
+inline void DrawEdges(Surface& surface, COLORREF color, BYTE alpha = 255, EdgeOperator op = EDGE_SOBEL, bool thin = false, float gain = 1.0f) {
+    if (surface.Empty()) {
+        return;
+    }
+    std::vector<BYTE> mask((size_t)surface.width * surface.height);
+    DetectEdges(surface, mask.data(), surface.width, op, thin, gain);
+    DWORD pixel = ToPixel(color, alpha);
+    ParallelFor(surface.height, [&surface, &mask, pixel](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            BlendMaskSpan(surface.Row(y), pixel, &mask[(size_t)y * surface.width], surface.width);
+        }
+    }, 32);
+}
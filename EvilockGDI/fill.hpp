@@ -0,0 +1,244 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "surface.hpp"
+#include "paint.hpp"
+#include "path.hpp"
+
+enum FillRule {
+    FILL_EVEN_ODD,  // 奇偶规则
+    FILL_NON_ZERO   // 非零环绕规则
+};
+
+// 活动边表扫描线填充多边形
+// 每个像素行取 16 条子扫描线，水平方向按跨度端点的小数部分精确累加覆盖率，
+// 最后把整行覆盖率分成全覆盖 / 部分覆盖的段：纯色全覆盖段直接宽指令写入，其余段按覆盖率混合
+class PolygonFiller {
+public:
+    PolygonFiller(Surface& target) : target(target), rule(FILL_NON_ZERO), originX(0), originY(0) {
+    }
+
+    void SetRule(FillRule newRule) {
+        rule = newRule;
+    }
+    // 设置绘制坐标的原点：坐标 (x, y) 会画到表面的 (x - originX, y - originY) 处
+    void SetOrigin(int x, int y) {
+        originX = x;
+        originY = y;
+    }
+
+    // 填充路径的所有轮廓（未闭合的轮廓按闭合处理）
+    void Fill(const Path& path, const Paint& paint) {
+        edges.clear();
+        for (size_t c = 0; c < path.contours.size(); c++) {
+            AddContour(path.contours[c].data(), (int)path.contours[c].size());
+        }
+        Rasterize(paint);
+    }
+    void Fill(const POINTFLOAT* points, int count, const Paint& paint) {
+        edges.clear();
+        AddContour(points, count);
+        Rasterize(paint);
+    }
+
+private:
+    static const int SUBSAMPLES = 16;         // 每个像素行的子扫描线数
+    static const int UNIT = 256;              // 一条子扫描线完整覆盖一个像素的累加值
+    static const int FULL = SUBSAMPLES * UNIT;
+
+    struct Edge {
+        float x;        // 上端点的 x
+        float dxdy;     // y 每增加 1 时 x 的变化量
+        float yTop;
+        float yBottom;
+        int winding;    // 向下的边为 +1，向上的边为 -1
+    };
+    struct Crossing {
+        float x;
+        int winding;
+        bool operator<(const Crossing& other) const {
+            return x < other.x;
+        }
+    };
+
+    Surface& target;
+    FillRule rule;
+    int originX;
+    int originY;
+    std::vector<Edge> edges;
+    std::vector<size_t> active;
+    std::vector<Crossing> crossings;
+    std::vector<int> cover;    // 差分数组：整像素覆盖从这里开始累加
+    std::vector<int> area;     // 跨度两端不满一个像素的覆盖
+    std::vector<BYTE> mask;
+    std::vector<_RGBQUAD> scratch;
+
+    void AddContour(const POINTFLOAT* points, int count) {
+        for (int i = 0; i < count; i++) {
+            POINTFLOAT a = points[i];
+            POINTFLOAT b = points[(i + 1) % count];
+            a.x -= originX; a.y -= originY;
+            b.x -= originX; b.y -= originY;
+            if (a.y == b.y) {
+                continue;
+            }
+            Edge e;
+            e.winding = b.y > a.y ? 1 : -1;
+            if (a.y > b.y) {
+                POINTFLOAT t = a; a = b; b = t;
+            }
+            e.x = a.x;
+            e.dxdy = (b.x - a.x) / (b.y - a.y);
+            e.yTop = a.y;
+            e.yBottom = b.y;
+            edges.push_back(e);
+        }
+    }
+
+    void Rasterize(const Paint& paint) {
+        if (edges.empty()) {
+            return;
+        }
+        std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.yTop < b.yTop; });
+        float yMin = edges.front().yTop;
+        float yMax = yMin;
+        float xMin = 1e30f, xMax = -1e30f;
+        for (size_t i = 0; i < edges.size(); i++) {
+            const Edge& e = edges[i];
+            yMax = max(yMax, e.yBottom);
+            float xEnd = e.x + e.dxdy * (e.yBottom - e.yTop);
+            xMin = min(xMin, min(e.x, xEnd));
+            xMax = max(xMax, max(e.x, xEnd));
+        }
+        int rowStart = max(0, (int)floorf(yMin));
+        int rowEnd = min(target.height, (int)ceilf(yMax));
+        int colStart = max(0, (int)floorf(xMin));
+        int colEnd = min(target.width, (int)ceilf(xMax) + 1);
+        if (rowStart >= rowEnd || colStart >= colEnd) {
+            return;
+        }
+        cover.assign(target.width + 2, 0);
+        area.assign(target.width + 2, 0);
+        mask.resize(target.width);
+        scratch.resize(target.width);
+
+        DWORD solidPixel = 0;
+        bool solid = paint.IsSolid(solidPixel);
+        bool opaque = paint.IsOpaque();
+        size_t nextEdge = 0;
+        active.clear();
+        for (int y = rowStart; y < rowEnd; y++) {
+            int spanMin = colEnd, spanMax = colStart;
+            for (int s = 0; s < SUBSAMPLES; s++) {
+                float ys = y + (s + 0.5f) / SUBSAMPLES;
+                // 更新活动边表：加入开始的边，去掉已经结束的边
+                while (nextEdge < edges.size() && edges[nextEdge].yTop <= ys) {
+                    active.push_back(nextEdge++);
+                }
+                size_t kept = 0;
+                for (size_t i = 0; i < active.size(); i++) {
+                    if (edges[active[i]].yBottom > ys) {
+                        active[kept++] = active[i];
+                    }
+                }
+                active.resize(kept);
+                if (active.empty()) {
+                    continue;
+                }
+
+                crossings.clear();
+                for (size_t i = 0; i < active.size(); i++) {
+                    const Edge& e = edges[active[i]];
+                    Crossing c = { e.x + (ys - e.yTop) * e.dxdy, e.winding };
+                    crossings.push_back(c);
+                }
+                std::sort(crossings.begin(), crossings.end());
+
+                int winding = 0;
+                for (size_t i = 0; i + 1 < crossings.size(); i++) {
+                    winding += crossings[i].winding;
+                    bool inside = rule == FILL_NON_ZERO ? winding != 0 : (winding & 1) != 0;
+                    if (inside) {
+                        AccumulateSpan(crossings[i].x, crossings[i + 1].x, spanMin, spanMax);
+                    }
+                }
+            }
+            if (spanMin < spanMax) {
+                ResolveRow(y, spanMin, spanMax, paint, solid, solidPixel, opaque);
+            }
+        }
+    }
+
+    // 在当前像素行累加一条子扫描线上 [x0, x1) 的覆盖
+    void AccumulateSpan(float x0, float x1, int& spanMin, int& spanMax) {
+        x0 = max(x0, 0.0f);
+        x1 = min(x1, (float)target.width);
+        if (x0 >= x1) {
+            return;
+        }
+        int i0 = (int)x0;
+        int i1 = (int)x1;
+        if (i0 == i1) {
+            area[i0] += (int)((x1 - x0) * UNIT + 0.5f);
+        }
+        else {
+            area[i0] += (int)((i0 + 1 - x0) * UNIT + 0.5f);
+            cover[i0 + 1] += UNIT;
+            cover[i1] -= UNIT;
+            area[i1] += (int)((x1 - i1) * UNIT + 0.5f);
+        }
+        spanMin = min(spanMin, i0);
+        spanMax = max(spanMax, min(i1 + 1, target.width));
+    }
+
+    // 把累加好的覆盖率转成 0～255 的蒙版，分段写入表面，并清空累加缓冲
+    void ResolveRow(int y, int x0, int x1, const Paint& paint, bool solid, DWORD solidPixel, bool opaque) {
+        int running = 0;
+        for (int x = x0; x < x1; x++) {
+            running += cover[x];
+            int value = min(FULL, running + area[x]);
+            mask[x] = (BYTE)((value * 255 + FULL / 2) / FULL);
+            cover[x] = 0;
+            area[x] = 0;
+        }
+        cover[x1] = 0;
+        area[x1] = 0;
+
+        PRGBQUAD row = target.Row(y);
+        int x = x0;
+        while (x < x1) {
+            // 按 未覆盖 / 全覆盖 / 部分覆盖 分段
+            int kind = mask[x] == 0 ? 0 : mask[x] == 255 ? 2 : 1;
+            int start = x;
+            while (x < x1 && (mask[x] == 0 ? 0 : mask[x] == 255 ? 2 : 1) == kind) {
+                x++;
+            }
+            int count = x - start;
+            bool full = kind == 2;
+            if (kind == 0) {
+                continue;
+            }
+            if (full && solid && opaque) {
+                FillSpan(row + start, solidPixel, count);
+            }
+            else if (solid) {
+                BlendMaskSpan(row + start, solidPixel, &mask[start], count);
+            }
+            else {
+                paint.Generate(start + originX, y + originY, count, &scratch[0]);
+                if (full && opaque) {
+                    memcpy(row + start, &scratch[0], count * sizeof(_RGBQUAD));
+                }
+                else if (full) {
+                    BlendSpan(row + start, &scratch[0], count);
+                }
+                else {
+                    BlendSpan(row + start, &scratch[0], &mask[start], count);
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,277 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "paint.hpp"
+
+// 超出 [0, 1] 的部分怎么处理
+enum GradientSpread {
+    SPREAD_PAD,      // 延续两端的颜色
+    SPREAD_REPEAT,   // 重复
+    SPREAD_REFLECT   // 来回镜像
+};
+
+// 渐变颜料的公共部分：多个色标在预乘 alpha 空间插值成 1024 项的查找表
+// 子类只负责用 SSE 每次算出 4 个像素的渐变参数 t，查表（可选有序抖动）由这里完成
+class Gradient : public Paint {
+public:
+    static const int LUT_SIZE = 1024;
+
+    Gradient() : spread(SPREAD_PAD), dither(false), opaque(true) {
+        lut.assign(LUT_SIZE, 0);
+        lut16.assign(LUT_SIZE * 4, 0);
+    }
+
+    // 在 position（0～1）处加一个色标，位置相同的色标按加入顺序排列，可以做出硬边
+    void AddStop(float position, COLORREF color, BYTE alpha = 255) {
+        Stop stop = { max(0.0f, min(1.0f, position)), GetRValue(color) * alpha / 255.0f, GetGValue(color) * alpha / 255.0f,
+            GetBValue(color) * alpha / 255.0f, static_cast<float>(alpha) };
+        std::vector<Stop>::iterator it = stops.begin();
+        while (it != stops.end() && it->position <= stop.position) {
+            ++it;
+        }
+        stops.insert(it, stop);
+        BuildLut();
+    }
+    void ClearStops() {
+        stops.clear();
+        BuildLut();
+    }
+    void SetSpread(GradientSpread newSpread) {
+        spread = newSpread;
+    }
+    // 开启后按 4x4 Bayer 矩阵做有序抖动，消除大面积平缓渐变的色带
+    void SetDither(bool enabled) {
+        dither = enabled;
+    }
+
+    void Generate(int x, int y, int count, PRGBQUAD out) const override {
+        if (count <= 0) {
+            return;
+        }
+        indices.resize((count + 3) & ~3);
+        ComputeIndices(x, y, count, indices.data());
+        if (!dither) {
+            DWORD* dst = reinterpret_cast<DWORD*>(out);
+            for (int i = 0; i < count; i++) {
+                dst[i] = lut[indices[i]];
+            }
+            return;
+        }
+        // 查表得到 8.8 定点的颜色，加上抖动阈值后取高 8 位；每次处理两个像素
+        static const BYTE bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+        const BYTE* thresholds = bayer[y & 3];
+        const WORD* table = lut16.data();
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128i a = _mm_loadl_epi64((const __m128i*)(table + indices[i] * 4));
+            __m128i b = _mm_loadl_epi64((const __m128i*)(table + indices[i + 1] * 4));
+            __m128i d = _mm_unpacklo_epi64(_mm_set1_epi16(thresholds[(x + i) & 3] * 16 + 8), _mm_set1_epi16(thresholds[(x + i + 1) & 3] * 16 + 8));
+            __m128i v = _mm_srli_epi16(_mm_adds_epu16(_mm_unpacklo_epi64(a, b), d), 8);
+            _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(v, v));
+        }
+        for (; i < count; i++) {
+            const WORD* c = table + indices[i] * 4;
+            int d = thresholds[(x + i) & 3] * 16 + 8;
+            out[i].b = static_cast<BYTE>(min(65535, c[0] + d) >> 8);
+            out[i].g = static_cast<BYTE>(min(65535, c[1] + d) >> 8);
+            out[i].r = static_cast<BYTE>(min(65535, c[2] + d) >> 8);
+            out[i].a = static_cast<BYTE>(min(65535, c[3] + d) >> 8);
+        }
+    }
+    bool IsOpaque() const override {
+        return opaque;
+    }
+
+    // 直接把渐变写进 target 的 [x, x + w) x [y, y + h) 区域，坐标就是表面坐标
+    void Fill(Surface& target, int x, int y, int w, int h) const {
+        int x0 = max(0, x);
+        int y0 = max(0, y);
+        int x1 = min(target.width, x + w);
+        int y1 = min(target.height, y + h);
+        for (int row = y0; row < y1; row++) {
+            Generate(x0, row, x1 - x0, target.Row(row) + x0);
+        }
+    }
+
+protected:
+    // 算出第 y 行从 x 开始 count 个像素（按 4 个一组，可以多写到 4 的倍数）的查表下标
+    virtual void ComputeIndices(int x, int y, int count, int* out) const = 0;
+
+    // 按扩展方式把 t 映射到 [0, 1]，再换算成查表下标
+    __m128i ToIndex(__m128 t) const {
+        const __m128 one = _mm_set1_ps(1.0f);
+        if (spread == SPREAD_REPEAT) {
+            t = _mm_sub_ps(t, Floor(t));
+        }
+        else if (spread == SPREAD_REFLECT) {
+            __m128 half = _mm_mul_ps(t, _mm_set1_ps(0.5f));
+            __m128 m = _mm_mul_ps(_mm_sub_ps(half, Floor(half)), _mm_set1_ps(2.0f));   // t mod 2
+            __m128 d = _mm_sub_ps(m, one);
+            t = _mm_sub_ps(one, _mm_max_ps(d, _mm_sub_ps(_mm_setzero_ps(), d)));    // 1 - |m - 1|
+        }
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(LUT_SIZE - 1.0f)), _mm_set1_ps(0.5f)));
+    }
+    static __m128 Floor(__m128 v) {
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+        // 负数截断后比原值大，需要再减 1
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, v), _mm_set1_ps(1.0f)));
+    }
+
+private:
+    struct Stop {
+        float position;
+        float r, g, b, a;   // 预乘后的颜色
+    };
+
+    std::vector<Stop> stops;
+    GradientSpread spread;
+    bool dither;
+    bool opaque;
+    std::vector<DWORD> lut;     // 预乘 BGRA
+    std::vector<WORD> lut16;    // 预乘 BGRA，每个通道 8.8 定点，抖动时使用
+    mutable std::vector<int> indices;
+
+    void BuildLut() {
+        opaque = true;
+        for (size_t i = 0; i < stops.size(); i++) {
+            opaque = opaque && stops[i].a >= 255.0f;
+        }
+        if (stops.empty()) {
+            lut.assign(LUT_SIZE, 0);
+            lut16.assign(LUT_SIZE * 4, 0);
+            opaque = false;
+            return;
+        }
+        size_t next = 0;
+        for (int i = 0; i < LUT_SIZE; i++) {
+            float t = i / (LUT_SIZE - 1.0f);
+            while (next < stops.size() && stops[next].position <= t) {
+                next++;
+            }
+            float c[4];
+            if (next == 0 || next == stops.size()) {
+                const Stop& s = stops[next == 0 ? 0 : stops.size() - 1];
+                c[0] = s.b; c[1] = s.g; c[2] = s.r; c[3] = s.a;
+            }
+            else {
+                const Stop& a = stops[next - 1];
+                const Stop& b = stops[next];
+                float f = b.position > a.position ? (t - a.position) / (b.position - a.position) : 1.0f;
+                c[0] = a.b + (b.b - a.b) * f;
+                c[1] = a.g + (b.g - a.g) * f;
+                c[2] = a.r + (b.r - a.r) * f;
+                c[3] = a.a + (b.a - a.a) * f;
+            }
+            DWORD pixel = 0;
+            for (int k = 0; k < 4; k++) {
+                // 8.8 定点的值加上 0～1 之间的抖动阈值再取整数部分，整数值不受抖动影响
+                int fixed = static_cast<int>(c[k] * 256.0f + 0.5f);
+                lut16[i * 4 + k] = static_cast<WORD>(min(255 * 256, fixed));
+                pixel |= static_cast<DWORD>(static_cast<int>(c[k] + 0.5f)) << (k * 8);
+            }
+            lut[i] = pixel;
+        }
+    }
+};
+
+// 线性渐变：(x0, y0) 处 t = 0，(x1, y1) 处 t = 1，沿垂直方向不变
+class LinearGradient : public Gradient {
+public:
+    LinearGradient(float x0, float y0, float x1, float y1) : x0(x0), y0(y0) {
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float length2 = dx * dx + dy * dy;
+        stepX = length2 > 0.0f ? dx / length2 : 0.0f;
+        stepY = length2 > 0.0f ? dy / length2 : 0.0f;
+    }
+
+protected:
+    void ComputeIndices(int x, int y, int count, int* out) const override {
+        // t 沿行方向线性变化，每 4 个像素加同一个增量
+        float start = (x + 0.5f - x0) * stepX + (y + 0.5f - y0) * stepY;
+        __m128 t = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_setr_ps(0, 1, 2, 3), _mm_set1_ps(stepX)));
+        __m128 step = _mm_set1_ps(stepX * 4);
+        for (int i = 0; i < count; i += 4) {
+            _mm_storeu_si128((__m128i*)(out + i), ToIndex(t));
+            t = _mm_add_ps(t, step);
+        }
+    }
+
+private:
+    float x0, y0;
+    float stepX, stepY;
+};
+
+// 径向渐变：圆心处 t = 0，半径 radius 处 t = 1
+class RadialGradient : public Gradient {
+public:
+    RadialGradient(float cx, float cy, float radius) : cx(cx), cy(cy), invRadius(radius > 0.0f ? 1.0f / radius : 0.0f) {
+    }
+
+protected:
+    void ComputeIndices(int x, int y, int count, int* out) const override {
+        float dy = (y + 0.5f - cy) * invRadius;
+        __m128 dy2 = _mm_set1_ps(dy * dy);
+        __m128 dx = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(x + 0.5f - cx), _mm_setr_ps(0, 1, 2, 3)), _mm_set1_ps(invRadius));
+        __m128 step = _mm_set1_ps(4 * invRadius);
+        for (int i = 0; i < count; i += 4) {
+            __m128 t = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dy2));
+            _mm_storeu_si128((__m128i*)(out + i), ToIndex(t));
+            dx = _mm_add_ps(dx, step);
+        }
+    }
+
+private:
+    float cx, cy;
+    float invRadius;
+};
+
+// 锥形（角度）渐变：绕 (cx, cy) 顺时针一圈 t 从 0 变到 1，startDegrees 为 t = 0 的方向
+class ConicGradient : public Gradient {
+public:
+    ConicGradient(float cx, float cy, float startDegrees = 0.0f) : cx(cx), cy(cy), start(startDegrees / 360.0f) {
+        SetSpread(SPREAD_REPEAT);
+    }
+
+protected:
+    void ComputeIndices(int x, int y, int count, int* out) const override {
+        __m128 dy = _mm_set1_ps(y + 0.5f - cy);
+        __m128 dx = _mm_add_ps(_mm_set1_ps(x + 0.5f - cx), _mm_setr_ps(0, 1, 2, 3));
+        __m128 step = _mm_set1_ps(4.0f);
+        __m128 scale = _mm_set1_ps(static_cast<float>(1.0 / (2 * PI)));
+        __m128 offset = _mm_set1_ps(start);
+        for (int i = 0; i < count; i += 4) {
+            __m128 t = _mm_sub_ps(_mm_mul_ps(Atan2(dy, dx), scale), offset);
+            _mm_storeu_si128((__m128i*)(out + i), ToIndex(t));
+            dx = _mm_add_ps(dx, step);
+        }
+    }
+
+private:
+    float cx, cy;
+    float start;
+
+    // 4 路 atan2 的多项式近似，误差约 1e-5 弧度，远小于查表精度
+    static __m128 Atan2(__m128 y, __m128 x) {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 ax = _mm_andnot_ps(signMask, x);
+        __m128 ay = _mm_andnot_ps(signMask, y);
+        __m128 hi = _mm_max_ps(ax, ay);
+        __m128 lo = _mm_min_ps(ax, ay);
+        __m128 a = _mm_div_ps(lo, _mm_max_ps(hi, _mm_set1_ps(1e-20f)));
+        __m128 s = _mm_mul_ps(a, a);
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), s), _mm_set1_ps(0.15931422f));
+        r = _mm_sub_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.327622764f));
+        r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+        __m128 steep = _mm_cmpgt_ps(ay, ax);
+        r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(1.57079637f), r)), _mm_andnot_ps(steep, r));
+        __m128 negX = _mm_cmplt_ps(x, _mm_setzero_ps());
+        r = _mm_or_ps(_mm_and_ps(negX, _mm_sub_ps(_mm_set1_ps(3.14159274f), r)), _mm_andnot_ps(negX, r));
+        return _mm_or_ps(r, _mm_and_ps(y, signMask));
+    }
+};
@@ -0,0 +1,125 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "palette.hpp"
+
+// 8 位索引表面：每个像素是 256 色调色板里的编号，动画只改调色板（循环、渐变），
+// 每帧的花费是改 256 个表项再加一遍展开成 32 位像素，不用逐像素重新计算颜色
+class IndexedSurface {
+public:
+    std::vector<BYTE> indices;  // 像素编号，第 y 行从 indices[y * width] 开始
+    _RGBQUAD colors[256];       // 调色板（预乘 alpha）
+    int width;
+    int height;
+
+    IndexedSurface() : width(0), height(0) {
+        memset(colors, 0, sizeof(colors));
+    }
+    IndexedSurface(int width, int height) : IndexedSurface() {
+        Create(width, height);
+    }
+
+    void Create(int newWidth, int newHeight) {
+        width = max(0, newWidth);
+        height = max(0, newHeight);
+        indices.assign((size_t)width * height, 0);
+    }
+    bool Empty() const {
+        return indices.empty();
+    }
+    BYTE* Row(int y) {
+        return &indices[(size_t)y * width];
+    }
+    const BYTE* Row(int y) const {
+        return &indices[(size_t)y * width];
+    }
+
+    // 把 palette 的颜色拷进调色板（多余的表项填黑色）
+    void SetPalette(const Palette& palette) {
+        memset(colors, 0, sizeof(colors));
+        int n = min(256, palette.Size());
+        for (int i = 0; i < n; i++) {
+            colors[i] = palette.colors[i];
+        }
+    }
+    // 按 palette 的逆调色板表把 source 转成编号（尺寸跟着 source），调色板同时换成 palette 的颜色
+    void FromSurface(const Surface& source, const Palette& palette) {
+        Create(source.width, source.height);
+        SetPalette(palette);
+        if (palette.colors.empty()) {
+            return;
+        }
+        ParallelFor(height, [this, &source, &palette](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                const _RGBQUAD* src = source.Row(y);
+                BYTE* dst = Row(y);
+                for (int x = 0; x < width; x++) {
+                    dst[x] = palette.Nearest(src[x]);
+                }
+            }
+        }, 16);
+    }
+
+    // 调色板循环：编号 [first, first + count) 的颜色整体向后转 steps 格（负数向前），画面上的颜色就沿着编号流动
+    void CyclePalette(int first, int count, int steps) {
+        first = max(0, min(255, first));
+        count = min(count, 256 - first);
+        if (count <= 1) {
+            return;
+        }
+        steps %= count;
+        if (steps < 0) {
+            steps += count;
+        }
+        std::rotate(colors + first, colors + first + count - steps, colors + first + count);
+    }
+    // 编号 [first, last] 之间填成 from 到 to 的渐变色
+    void SetGradient(int first, int last, COLORREF from, COLORREF to) {
+        first = max(0, min(255, first));
+        last = max(first, min(255, last));
+        int span = max(1, last - first);
+        for (int i = first; i <= last; i++) {
+            int t = (i - first) * 255 / span;
+            colors[i].r = (BYTE)((GetRValue(from) * (255 - t) + GetRValue(to) * t) / 255);
+            colors[i].g = (BYTE)((GetGValue(from) * (255 - t) + GetGValue(to) * t) / 255);
+            colors[i].b = (BYTE)((GetBValue(from) * (255 - t) + GetBValue(to) * t) / 255);
+            colors[i].a = 255;
+        }
+    }
+
+    // 按当前调色板展开成 32 位像素写到 target（尺寸不同时重新创建）
+    // SSE2 没有按字节查表的指令（pshufb 也只能查 16 项），一次读 4 个编号、查 4 次表拼成一个向量写出
+    void Expand(Surface& target) const {
+        if (Empty()) {
+            return;
+        }
+        if (target.width != width || target.height != height) {
+            target.Create(width, height);
+        }
+        ParallelFor(height, [this, &target](int begin, int end) {
+            const DWORD* table = (const DWORD*)colors;
+            for (int y = begin; y < end; y++) {
+                const BYTE* src = Row(y);
+                PRGBQUAD dst = target.Row(y);
+                int x = 0;
+                for (; x + 8 <= width; x += 8) {
+                    DWORD lo, hi;
+                    memcpy(&lo, src + x, 4);
+                    memcpy(&hi, src + x + 4, 4);
+                    __m128i a = _mm_set_epi32((int)table[lo >> 24], (int)table[(lo >> 16) & 255], (int)table[(lo >> 8) & 255], (int)table[lo & 255]);
+                    __m128i b = _mm_set_epi32((int)table[hi >> 24], (int)table[(hi >> 16) & 255], (int)table[(hi >> 8) & 255], (int)table[hi & 255]);
+                    _mm_storeu_si128((__m128i*)(dst + x), a);
+                    _mm_storeu_si128((__m128i*)(dst + x + 4), b);
+                }
+                for (; x < width; x++) {
+                    dst[x].rgb = table[src[x]];
+                }
+            }
+        }, 16);
+    }
+};
@@ -0,0 +1,270 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "transpose.hpp"
+
+// 排序类滤镜：中值滤波、膨胀（取最大值）、腐蚀（取最小值），每个通道独立处理，边缘外按最近的边缘像素计算
+
+// 中值滤波的最大半径：窗口内的像素个数 (2r+1)^2 要能用 16 位计数
+const int MEDIAN_MAX_RADIUS = 127;
+
+// 中值滤波按列条处理，一条列条的列直方图能留在二级缓存里
+const int MEDIAN_STRIP = 128;
+
+// 中值滤波（Perreault–Hébert）：每一列维护一个竖直方向 2r+1 个像素的直方图，向下移动一行只要加一个、减一个像素
+// 窗口直方图由列直方图相加得到，分成 16 个粗分桶和 256 个细分桶：粗分桶每移动一个像素都更新，
+// 细分桶只在中值落进去时才补上落下的更新，所以每个像素的计算量和半径无关
+// 结果写到和 source 一样大的 target 上（两者不能是同一块像素），行分成几段交给多个线程
+inline void MedianFilter(const Surface& source, Surface& target, int radius) {
+    if (source.Empty() || target.Empty() || source.width != target.width || source.height != target.height) {
+        return;
+    }
+    radius = max(0, min(radius, MEDIAN_MAX_RADIUS));
+    int w = source.width;
+    int h = source.height;
+    if (radius == 0) {
+        memcpy(target.pixels, source.pixels, source.Bytes());
+        return;
+    }
+    int size = radius * 2 + 1;
+    int rank = size * size / 2;     // 中值是窗口里第 rank 个（从 0 数）
+    ParallelFor(h, [&source, &target, w, h, radius, size, rank](int begin, int end) {
+        // 列直方图：列条里第 i 列第 c 个通道的细分桶从 fine[(i * 4 + c) * 256] 开始，粗分桶从 coarse[(i * 4 + c) * 16] 开始
+        std::vector<WORD> fine;
+        std::vector<WORD> coarse;
+        // 窗口直方图（每个通道 256 个细分桶、16 个粗分桶）和细分桶各段最后一次更新时的窗口中心
+        __m128i kernelFine[4][32];
+        __m128i kernelCoarse[4][2];
+        int updated[4][16];
+        for (int strip = 0; strip < w; strip += MEDIAN_STRIP) {
+            int stripEnd = min(w, strip + MEDIAN_STRIP);
+            // 列条需要的列（超出表面的列取边缘列）
+            int first = max(0, strip - radius);
+            int last = min(w - 1, stripEnd + radius);
+            int columns = last - first + 1;
+            fine.assign((size_t)columns * 4 * 256, 0);
+            coarse.assign((size_t)columns * 4 * 16, 0);
+            for (int dy = -radius; dy <= radius; dy++) {
+                const BYTE* row = (const BYTE*)(source.Row(max(0, min(h - 1, begin + dy))) + first);
+                for (int i = 0; i < columns * 4; i++) {
+                    fine[(size_t)i * 256 + row[i]]++;
+                    coarse[(size_t)i * 16 + (row[i] >> 4)]++;
+                }
+            }
+            for (int y = begin; y < end; y++) {
+                if (y > begin) {
+                    const BYTE* out = (const BYTE*)(source.Row(max(0, y - radius - 1)) + first);
+                    const BYTE* in = (const BYTE*)(source.Row(min(h - 1, y + radius)) + first);
+                    for (int i = 0; i < columns * 4; i++) {
+                        fine[(size_t)i * 256 + out[i]]--;
+                        coarse[(size_t)i * 16 + (out[i] >> 4)]--;
+                        fine[(size_t)i * 256 + in[i]]++;
+                        coarse[(size_t)i * 16 + (in[i] >> 4)]++;
+                    }
+                }
+                memset(kernelCoarse, 0, sizeof(kernelCoarse));
+                for (int dx = -radius; dx <= radius; dx++) {
+                    int i = max(0, min(w - 1, strip + dx)) - first;
+                    for (int c = 0; c < 4; c++) {
+                        const WORD* column = &coarse[(size_t)(i * 4 + c) * 16];
+                        kernelCoarse[c][0] = _mm_add_epi16(kernelCoarse[c][0], _mm_loadu_si128((const __m128i*)column));
+                        kernelCoarse[c][1] = _mm_add_epi16(kernelCoarse[c][1], _mm_loadu_si128((const __m128i*)(column + 8)));
+                    }
+                }
+                for (int c = 0; c < 4; c++) {
+                    for (int k = 0; k < 16; k++) {
+                        updated[c][k] = strip - size - 1;
+                    }
+                }
+                BYTE* dst = (BYTE*)target.Row(y);
+                for (int x = strip; x < stripEnd; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        // 先在粗分桶里找到中值所在的段
+                        const WORD* coarseBins = (const WORD*)kernelCoarse[c];
+                        int k = 0;
+                        int sum = 0;
+                        while (sum + coarseBins[k] <= rank) {
+                            sum += coarseBins[k];
+                            k++;
+                        }
+                        // 把这一段细分桶更新到以 x 为中心的窗口：落后太多就重新累加，否则补上漏掉的几步
+                        __m128i* segment = &kernelFine[c][k * 2];
+                        if (updated[c][k] <= x - size) {
+                            segment[0] = segment[1] = _mm_setzero_si128();
+                            for (int dx = -radius; dx <= radius; dx++) {
+                                const WORD* column = &fine[(size_t)((max(0, min(w - 1, x + dx)) - first) * 4 + c) * 256 + k * 16];
+                                segment[0] = _mm_add_epi16(segment[0], _mm_loadu_si128((const __m128i*)column));
+                                segment[1] = _mm_add_epi16(segment[1], _mm_loadu_si128((const __m128i*)(column + 8)));
+                            }
+                        }
+                        else {
+                            for (int cx = updated[c][k] + 1; cx <= x; cx++) {
+                                const WORD* in = &fine[(size_t)((min(w - 1, cx + radius) - first) * 4 + c) * 256 + k * 16];
+                                const WORD* out = &fine[(size_t)((max(0, cx - radius - 1) - first) * 4 + c) * 256 + k * 16];
+                                segment[0] = _mm_sub_epi16(_mm_add_epi16(segment[0], _mm_loadu_si128((const __m128i*)in)), _mm_loadu_si128((const __m128i*)out));
+                                segment[1] = _mm_sub_epi16(_mm_add_epi16(segment[1], _mm_loadu_si128((const __m128i*)(in + 8))), _mm_loadu_si128((const __m128i*)(out + 8)));
+                            }
+                        }
+                        updated[c][k] = x;
+                        const WORD* fineBins = (const WORD*)kernelFine[c];
+                        int bin = k * 16;
+                        while (sum + fineBins[bin] <= rank) {
+                            sum += fineBins[bin];
+                            bin++;
+                        }
+                        dst[x * 4 + c] = (BYTE)bin;
+                    }
+                    // 窗口右移一列，粗分桶加上新进来的一列、减去出去的一列
+                    const WORD* in = &coarse[(size_t)(min(w - 1, x + radius + 1) - first) * 4 * 16];
+                    const WORD* out = &coarse[(size_t)(max(0, x - radius) - first) * 4 * 16];
+                    for (int i = 0; i < 8; i++) {
+                        __m128i* v = &kernelCoarse[0][0] + i;
+                        *v = _mm_sub_epi16(_mm_add_epi16(*v, _mm_loadu_si128((const __m128i*)in + i)), _mm_loadu_si128((const __m128i*)out + i));
+                    }
+                }
+            }
+        }
+    }, 32);
+}
+
+// 原地中值滤波：先把原图拷一份作为输入
+inline void MedianFilter(Surface& surface, int radius) {
+    if (surface.Empty()) {
+        return;
+    }
+    std::vector<_RGBQUAD> copy(surface.pixels, surface.pixels + (size_t)surface.width * surface.height);
+    Surface source(copy.data(), surface.width, surface.height);
+    MedianFilter(source, surface, radius);
+}
+
+// 逐字节取最大 / 最小值
+struct MaxOp {
+    static __m128i Apply(__m128i a, __m128i b) {
+        return _mm_max_epu8(a, b);
+    }
+};
+struct MinOp {
+    static __m128i Apply(__m128i a, __m128i b) {
+        return _mm_min_epu8(a, b);
+    }
+};
+
+// van Herk / Gil-Werman 一维最值滤波：把 count 条线（第 i 条从 base + i * stride 开始，每条 n 个像素，n 为 4 的倍数）
+// 按线的方向做窗口为 2r+1 的最大 / 最小值，每条线同一位置的像素一起用 SIMD 计算
+// 线的序列两端各延伸 r 条边缘线后切成长为 2r+1 的块，块内从前往后的前缀值 prefix 和从后往前的后缀值 suffix 各算一遍，
+// 窗口 [i, i + 2r] 的结果就是 Op(suffix[i], prefix[i + 2r])，每个像素只比较三次
+template <typename Op>
+inline void VanHerkLines(PRGBQUAD base, int stride, int count, int n, int radius, std::vector<_RGBQUAD>& prefix, std::vector<_RGBQUAD>& suffix) {
+    int size = radius * 2 + 1;
+    int extended = count + radius * 2;
+    prefix.resize((size_t)extended * n);
+    suffix.resize((size_t)extended * n);
+    for (int e = 0; e < extended; e++) {
+        const _RGBQUAD* line = base + (size_t)max(0, min(count - 1, e - radius)) * stride;
+        __m128i* p = (__m128i*)&prefix[(size_t)e * n];
+        if (e % size == 0) {
+            memcpy(p, line, n * sizeof(_RGBQUAD));
+            continue;
+        }
+        const __m128i* previous = (const __m128i*)&prefix[(size_t)(e - 1) * n];
+        for (int i = 0; i < n / 4; i++) {
+            _mm_storeu_si128(p + i, Op::Apply(_mm_loadu_si128(previous + i), _mm_loadu_si128((const __m128i*)line + i)));
+        }
+    }
+    for (int e = extended - 1; e >= 0; e--) {
+        const _RGBQUAD* line = base + (size_t)max(0, min(count - 1, e - radius)) * stride;
+        __m128i* s = (__m128i*)&suffix[(size_t)e * n];
+        if (e % size == size - 1 || e == extended - 1) {
+            memcpy(s, line, n * sizeof(_RGBQUAD));
+            continue;
+        }
+        const __m128i* next = (const __m128i*)&suffix[(size_t)(e + 1) * n];
+        for (int i = 0; i < n / 4; i++) {
+            _mm_storeu_si128(s + i, Op::Apply(_mm_loadu_si128(next + i), _mm_loadu_si128((const __m128i*)line + i)));
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        const __m128i* s = (const __m128i*)&suffix[(size_t)i * n];
+        const __m128i* p = (const __m128i*)&prefix[(size_t)(i + radius * 2) * n];
+        __m128i* out = (__m128i*)(base + (size_t)i * stride);
+        for (int j = 0; j < n / 4; j++) {
+            _mm_storeu_si128(out + j, Op::Apply(_mm_loadu_si128(s + j), _mm_loadu_si128(p + j)));
+        }
+    }
+}
+
+// 每次处理的行数 / 列数（4 的倍数）
+const int MORPHOLOGY_BAND = 16;
+
+// 矩形窗口 (2rx+1) x (2ry+1) 的最值滤波：水平方向把一段行转置到临时缓冲里，把每一列当作一条线处理；
+// 竖直方向把每一行当作一条线，按列带处理；两个方向都分给多个线程
+template <typename Op>
+inline void RankFilter(Surface& surface, int rx, int ry) {
+    if (surface.Empty()) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    if (rx > 0) {
+        ParallelFor((h + MORPHOLOGY_BAND - 1) / MORPHOLOGY_BAND, [&surface, w, h, rx](int begin, int end) {
+            std::vector<_RGBQUAD> scratch((size_t)w * MORPHOLOGY_BAND);
+            std::vector<_RGBQUAD> prefix, suffix;
+            for (int band = begin; band < end; band++) {
+                int y0 = band * MORPHOLOGY_BAND;
+                int n = min(MORPHOLOGY_BAND, h - y0);
+                // 不满一段时重复最后一行，凑够 SIMD 的宽度
+                TransposeRegion(surface.Row(y0), w, scratch.data(), MORPHOLOGY_BAND, w, n);
+                for (int x = 0; x < w; x++) {
+                    for (int i = n; i < MORPHOLOGY_BAND; i++) {
+                        scratch[(size_t)x * MORPHOLOGY_BAND + i] = scratch[(size_t)x * MORPHOLOGY_BAND + n - 1];
+                    }
+                }
+                VanHerkLines<Op>(scratch.data(), MORPHOLOGY_BAND, w, MORPHOLOGY_BAND, rx, prefix, suffix);
+                TransposeRegion(scratch.data(), MORPHOLOGY_BAND, surface.Row(y0), w, n, w);
+            }
+        }, 1);
+    }
+    if (ry > 0) {
+        int w4 = w & ~3;
+        ParallelFor((w4 + MORPHOLOGY_BAND - 1) / MORPHOLOGY_BAND, [&surface, w4, h, ry](int begin, int end) {
+            std::vector<_RGBQUAD> prefix, suffix;
+            for (int band = begin; band < end; band++) {
+                int x0 = band * MORPHOLOGY_BAND;
+                VanHerkLines<Op>(surface.Row(0) + x0, surface.width, h, min(MORPHOLOGY_BAND, w4 - x0), ry, prefix, suffix);
+            }
+        }, 1);
+        // 右边不满 4 列的部分拷到临时缓冲里补齐再算
+        if (w4 < w) {
+            std::vector<_RGBQUAD> rest((size_t)h * 4);
+            for (int y = 0; y < h; y++) {
+                for (int i = 0; i < 4; i++) {
+                    rest[(size_t)y * 4 + i] = surface.Row(y)[min(w - 1, w4 + i)];
+                }
+            }
+            std::vector<_RGBQUAD> prefix, suffix;
+            VanHerkLines<Op>(rest.data(), 4, h, 4, ry, prefix, suffix);
+            for (int y = 0; y < h; y++) {
+                memcpy(surface.Row(y) + w4, &rest[(size_t)y * 4], (w - w4) * sizeof(_RGBQUAD));
+            }
+        }
+    }
+}
+
+// 膨胀：每个通道取 (2rx+1) x (2ry+1) 窗口内的最大值，亮的部分向外扩张
+inline void Dilate(Surface& surface, int rx, int ry) {
+    RankFilter<MaxOp>(surface, rx, ry);
+}
+inline void Dilate(Surface& surface, int radius) {
+    RankFilter<MaxOp>(surface, radius, radius);
+}
+// 腐蚀：每个通道取窗口内的最小值，暗的部分向外扩张
+inline void Erode(Surface& surface, int rx, int ry) {
+    RankFilter<MinOp>(surface, rx, ry);
+}
+inline void Erode(Surface& surface, int radius) {
+    RankFilter<MinOp>(surface, radius, radius);
+}
@@ -0,0 +1,222 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 马赛克：画面切成 blockWidth x blockHeight 的块，每块填成块内像素的平均色（右 / 下边缘不足一块的按实际大小平均）
+// 每一行块分给一个线程，块内逐行用 SIMD 把像素累加到 4 个 32 位通道和里，再整段填充
+inline void Pixelate(Surface& surface, int blockWidth, int blockHeight) {
+    if (surface.Empty() || blockWidth <= 0 || blockHeight <= 0 || (blockWidth == 1 && blockHeight == 1)) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    int bands = (h + blockHeight - 1) / blockHeight;
+    ParallelFor(bands, [&surface, w, h, blockWidth, blockHeight](int begin, int end) {
+        const __m128i zero = _mm_setzero_si128();
+        for (int band = begin; band < end; band++) {
+            int y0 = band * blockHeight;
+            int y1 = min(h, y0 + blockHeight);
+            for (int x0 = 0; x0 < w; x0 += blockWidth) {
+                int n = min(blockWidth, w - x0);
+                __m128i sum = zero;
+                for (int y = y0; y < y1; y++) {
+                    const _RGBQUAD* p = surface.Row(y) + x0;
+                    // 每次 4 个像素：展开成 16 位后两半相加（不超过 4 * 255），再展开成 32 位累加
+                    __m128i row = zero;
+                    int x = 0;
+                    for (; x + 4 <= n; x += 4) {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(p + x));
+                        __m128i s = _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero));
+                        row = _mm_add_epi32(row, _mm_add_epi32(_mm_unpacklo_epi16(s, zero), _mm_unpackhi_epi16(s, zero)));
+                    }
+                    for (; x < n; x++) {
+                        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)p[x].rgb), zero);
+                        row = _mm_add_epi32(row, _mm_unpacklo_epi16(v, zero));
+                    }
+                    sum = _mm_add_epi32(sum, row);
+                }
+                DWORD sums[4];
+                _mm_storeu_si128((__m128i*)sums, sum);
+                DWORD count = (DWORD)(n * (y1 - y0));
+                _RGBQUAD average;
+                average.b = (BYTE)((sums[0] + count / 2) / count);
+                average.g = (BYTE)((sums[1] + count / 2) / count);
+                average.r = (BYTE)((sums[2] + count / 2) / count);
+                average.a = (BYTE)((sums[3] + count / 2) / count);
+                for (int y = y0; y < y1; y++) {
+                    FillSpan(surface.Row(y) + x0, average.rgb, n);
+                }
+            }
+        }
+    }, 1);
+}
+
+inline void Pixelate(Surface& surface, int block) {
+    Pixelate(surface, block, block);
+}
+
+// 有序抖动用的阈值图案
+enum DitherPattern {
+    DITHER_NONE,        // 不抖动，直接就近取色阶
+    DITHER_BAYER4,      // 4x4 Bayer 矩阵
+    DITHER_BAYER8,      // 8x8 Bayer 矩阵
+    DITHER_BLUE_NOISE   // 32x32 蓝噪声（没有 Bayer 的十字纹理，颗粒更自然）
+};
+
+// n x n（n 为 2 的幂）Bayer 矩阵，值为 0～n*n-1：M(2n) = [4M, 4M+2; 4M+3, 4M+1]
+inline void BayerMatrix(int n, std::vector<WORD>& ranks) {
+    ranks.assign(1, 0);
+    for (int size = 1; size < n; size *= 2) {
+        std::vector<WORD> next((size_t)size * size * 4);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                WORD v = (WORD)(ranks[y * size + x] * 4);
+                next[y * size * 2 + x] = v;
+                next[y * size * 2 + x + size] = (WORD)(v + 2);
+                next[(y + size) * size * 2 + x] = (WORD)(v + 3);
+                next[(y + size) * size * 2 + x + size] = (WORD)(v + 1);
+            }
+        }
+        ranks.swap(next);
+    }
+}
+
+// 蓝噪声图案的边长
+const int BLUE_NOISE_SIZE = 32;
+
+// 用 void-and-cluster 方法生成的 32x32 蓝噪声排名（0～1023），第一次调用时生成一次
+// 每个点的“能量”是周围（环形）已选点的高斯权重之和：先从随机点集反复把最密的点挪到最空的位置直到稳定，
+// 然后从这个点集出发依次去掉最密的点、依次加入最空的点，按加入 / 去掉的顺序给每个位置排名
+inline const std::vector<WORD>& BlueNoiseRanks() {
+    static const std::vector<WORD> ranks = []() {
+        const int n = BLUE_NOISE_SIZE;
+        const int count = n * n;
+        // 环形距离下的高斯核，kernel[dy * n + dx]
+        std::vector<float> kernel(count);
+        for (int dy = 0; dy < n; dy++) {
+            for (int dx = 0; dx < n; dx++) {
+                int ex = min(dx, n - dx);
+                int ey = min(dy, n - dy);
+                kernel[dy * n + dx] = expf(-(ex * ex + ey * ey) / (2.0f * 1.5f * 1.5f));
+            }
+        }
+        std::vector<BYTE> pattern(count, 0);
+        std::vector<float> energy(count, 0.0f);
+        auto update = [&](int p, float sign) {
+            int px = p % n, py = p / n;
+            for (int y = 0; y < n; y++) {
+                for (int x = 0; x < n; x++) {
+                    energy[y * n + x] += sign * kernel[((y - py + n) % n) * n + (x - px + n) % n];
+                }
+            }
+        };
+        // 已选点里能量最大的（最密）/ 未选点里能量最小的（最空）
+        auto tightest = [&]() {
+            int best = -1;
+            for (int i = 0; i < count; i++) {
+                if (pattern[i] && (best < 0 || energy[i] > energy[best])) {
+                    best = i;
+                }
+            }
+            return best;
+        };
+        auto largestVoid = [&]() {
+            int best = -1;
+            for (int i = 0; i < count; i++) {
+                if (!pattern[i] && (best < 0 || energy[i] < energy[best])) {
+                    best = i;
+                }
+            }
+            return best;
+        };
+        // 初始点集：固定种子的伪随机，约 1/10 的位置
+        DWORD seed = 12345;
+        int ones = 0;
+        while (ones < count / 10) {
+            seed = seed * 1664525u + 1013904223u;
+            int p = (int)((seed >> 8) % count);
+            if (!pattern[p]) {
+                pattern[p] = 1;
+                update(p, 1.0f);
+                ones++;
+            }
+        }
+        for (int iteration = 0; iteration < count; iteration++) {
+            int cluster = tightest();
+            pattern[cluster] = 0;
+            update(cluster, -1.0f);
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            update(hole, 1.0f);
+            if (hole == cluster) {
+                break;
+            }
+        }
+        std::vector<WORD> result(count);
+        std::vector<BYTE> initial = pattern;
+        std::vector<float> initialEnergy = energy;
+        for (int rank = ones - 1; rank >= 0; rank--) {
+            int cluster = tightest();
+            pattern[cluster] = 0;
+            update(cluster, -1.0f);
+            result[cluster] = (WORD)rank;
+        }
+        pattern.swap(initial);
+        energy.swap(initialEnergy);
+        for (int rank = ones; rank < count; rank++) {
+            int hole = largestVoid();
+            pattern[hole] = 1;
+            update(hole, 1.0f);
+            result[hole] = (WORD)rank;
+        }
+        return result;
+    }();
+    return ranks;
+}
+
+// 色调分离 + 有序抖动：每个通道量化成 levels 个色阶（2～256），量化前加上按图案位置变化的阈值偏移，
+// 平均下来仍能表现出色阶之间的颜色；alpha 不变，只扫描一遍
+inline void Posterize(Surface& surface, int levels, DitherPattern pattern = DITHER_BAYER4) {
+    if (surface.Empty()) {
+        return;
+    }
+    levels = max(2, min(256, levels));
+    std::vector<WORD> ranks;
+    int n = 1;
+    if (pattern == DITHER_BAYER4 || pattern == DITHER_BAYER8) {
+        n = pattern == DITHER_BAYER4 ? 4 : 8;
+        BayerMatrix(n, ranks);
+    }
+    else if (pattern == DITHER_BLUE_NOISE) {
+        n = BLUE_NOISE_SIZE;
+        ranks = BlueNoiseRanks();
+    }
+    // 阈值偏移在 0～一个色阶之间；不抖动时偏移半个色阶，就是四舍五入
+    std::vector<int> bias((size_t)n * n);
+    for (int i = 0; i < n * n; i++) {
+        float t = pattern == DITHER_NONE ? 0.5f : (ranks[i] + 0.5f) / (n * n);
+        bias[i] = (int)(t * 255.0f / (levels - 1));
+    }
+    // 加上偏移后的值（最大 255 + 255）向下取整到色阶
+    BYTE table[512];
+    for (int i = 0; i < 512; i++) {
+        int level = min(255, i) * (levels - 1) / 255;
+        table[i] = (BYTE)((level * 255 + (levels - 1) / 2) / (levels - 1));
+    }
+    ParallelFor(surface.height, [&surface, &bias, &table, n](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            PRGBQUAD row = surface.Row(y);
+            const int* line = &bias[(size_t)(y & (n - 1)) * n];
+            for (int x = 0; x < surface.width; x++) {
+                int b = line[x & (n - 1)];
+                row[x].b = table[row[x].b + b];
+                row[x].g = table[row[x].g + b];
+                row[x].r = table[row[x].r + b];
+            }
+        }
+    }, 16);
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include "surface.hpp"
+
+// 填充用的颜料：按行生成一段预乘 alpha 的像素，坐标为绘制坐标
+class Paint {
+public:
+    virtual ~Paint() {
+    }
+    // 生成第 y 行从 x 开始的 count 个像素
+    virtual void Generate(int x, int y, int count, PRGBQUAD out) const = 0;
+    // 纯色颜料返回 true 并给出像素值，填充时可以直接写入而不必逐像素生成
+    virtual bool IsSolid(DWORD& pixel) const {
+        return false;
+    }
+    // 生成的像素全部不透明时返回 true，全覆盖的部分可以直接拷贝
+    virtual bool IsOpaque() const {
+        return false;
+    }
+};
+
+class SolidPaint : public Paint {
+public:
+    DWORD pixel;
+
+    SolidPaint(COLORREF color, BYTE alpha = 255) : pixel(ToPixel(color, alpha)) {
+    }
+    void Generate(int x, int y, int count, PRGBQUAD out) const override {
+        FillSpan(out, pixel, count);
+    }
+    bool IsSolid(DWORD& value) const override {
+        value = pixel;
+        return true;
+    }
+    bool IsOpaque() const override {
+        return (pixel >> 24) == 255;
+    }
+};
+
+// 平铺的纹理，(offsetX, offsetY) 是纹理左上角所在的绘制坐标
+// 从屏幕或位图拷来的表面 alpha 通常是 0，forceOpaque 为真时把它们当作不透明处理
+class TexturePaint : public Paint {
+public:
+    const Surface& texture;
+    int offsetX;
+    int offsetY;
+    bool forceOpaque;
+
+    TexturePaint(const Surface& texture, int offsetX = 0, int offsetY = 0, bool forceOpaque = true)
+        : texture(texture), offsetX(offsetX), offsetY(offsetY), forceOpaque(forceOpaque) {
+    }
+    void Generate(int x, int y, int count, PRGBQUAD out) const override {
+        int ty = Wrap(y - offsetY, texture.height);
+        int tx = Wrap(x - offsetX, texture.width);
+        const _RGBQUAD* row = texture.Row(ty);
+        // 按纹理宽度分段整块拷贝
+        int done = 0;
+        while (done < count) {
+            int chunk = min(count - done, texture.width - tx);
+            memcpy(out + done, row + tx, chunk * sizeof(_RGBQUAD));
+            done += chunk;
+            tx = 0;
+        }
+        if (forceOpaque) {
+            const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128i p = _mm_loadu_si128((__m128i*)(out + i));
+                _mm_storeu_si128((__m128i*)(out + i), _mm_or_si128(p, alpha));
+            }
+            for (; i < count; i++) {
+                out[i].a = 255;
+            }
+        }
+    }
+    bool IsOpaque() const override {
+        return forceOpaque;
+    }
+
+private:
+    static int Wrap(int v, int size) {
+        v %= size;
+        return v < 0 ? v + size : v;
+    }
+};
@@ -0,0 +1,276 @@
+﻿#pragma once
+#include <Windows.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 调色板：最多 256 种颜色，附带一张逆调色板表用来 O(1) 查找最近的颜色
+class Palette {
+public:
+    std::vector<_RGBQUAD> colors;   // 调色板颜色（alpha 为 255）
+    std::vector<BYTE> inverse;      // 逆调色板：按 r 高 5 位、g 高 6 位、b 高 5 位（5-6-5）索引，值是最近颜色的编号
+
+    int Size() const {
+        return (int)colors.size();
+    }
+    // 5-6-5 网格里每个格子中心对应的最近颜色（欧氏距离），改动 colors 后要重新调用
+    // 每次和 4 种颜色比较：r、g 的差成对放进 16 位通道，pmaddwd 一步得到 dr^2 + dg^2
+    void BuildInverse() {
+        inverse.assign(65536, 0);
+        if (colors.empty()) {
+            return;
+        }
+        // 颜色数补齐到 4 的倍数（重复最后一种，比较用严格小于，不会选到补上的编号）
+        int n = (int)colors.size();
+        int padded = (n + 3) & ~3;
+        std::vector<short> rg((size_t)padded * 2), b((size_t)padded * 2, 0);
+        for (int k = 0; k < padded; k++) {
+            const _RGBQUAD& c = colors[min(k, n - 1)];
+            rg[k * 2] = c.r;
+            rg[k * 2 + 1] = c.g;
+            b[k * 2] = c.b;
+        }
+        ParallelFor(65536, [this, &rg, &b, padded](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                int r = ((i >> 11) << 3) | 4;
+                int g = (((i >> 5) & 63) << 2) | 2;
+                int blue = ((i & 31) << 3) | 4;
+                const __m128i cellRG = _mm_set1_epi32((g << 16) | r);
+                const __m128i cellB = _mm_set1_epi32(blue);
+                __m128i bestDistance = _mm_set1_epi32(INT_MAX);
+                __m128i bestIndex = _mm_setzero_si128();
+                __m128i index = _mm_set_epi32(3, 2, 1, 0);
+                const __m128i four = _mm_set1_epi32(4);
+                for (int k = 0; k < padded; k += 4) {
+                    __m128i drg = _mm_sub_epi16(cellRG, _mm_loadu_si128((const __m128i*)&rg[k * 2]));
+                    __m128i db = _mm_sub_epi16(cellB, _mm_loadu_si128((const __m128i*)&b[k * 2]));
+                    __m128i d = _mm_add_epi32(_mm_madd_epi16(drg, drg), _mm_madd_epi16(db, db));
+                    __m128i closer = _mm_cmplt_epi32(d, bestDistance);
+                    bestDistance = _mm_or_si128(_mm_and_si128(closer, d), _mm_andnot_si128(closer, bestDistance));
+                    bestIndex = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex));
+                    index = _mm_add_epi32(index, four);
+                }
+                int distances[4], indices[4];
+                _mm_storeu_si128((__m128i*)distances, bestDistance);
+                _mm_storeu_si128((__m128i*)indices, bestIndex);
+                int best = 0;
+                for (int lane = 1; lane < 4; lane++) {
+                    if (distances[lane] < distances[best] || (distances[lane] == distances[best] && indices[lane] < indices[best])) {
+                        best = lane;
+                    }
+                }
+                inverse[i] = (BYTE)indices[best];
+            }
+        }, 1024);
+    }
+    // 最近颜色的编号（需要先 BuildInverse）
+    BYTE Nearest(int r, int g, int b) const {
+        return inverse[((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)];
+    }
+    BYTE Nearest(const _RGBQUAD& p) const {
+        return Nearest(p.r, p.g, p.b);
+    }
+};
+
+// 八叉树颜色量化：每个像素按 r、g、b 各一位决定在每层走哪个子节点，叶子节点累计颜色和与像素数
+// 叶子数超过 colors 时，把最深一层中像素最少的节点的子节点合并成它自己，直到叶子数不超过 colors
+// （一次合并最多减少 7 个叶子，最后得到的颜色数可能比 colors 少几个）
+// 只取每隔 step 行、step 列的像素（抽样），palette 的逆调色板表也一起生成
+const int OCTREE_DEPTH = 6;
+inline void BuildOctreePalette(const Surface& surface, int colors, Palette& palette, int step = 4) {
+    struct Node {
+        int children[8];
+        DWORD count;
+        ULONGLONG r, g, b;
+        bool leaf;
+    };
+    palette.colors.clear();
+    colors = max(1, min(256, colors));
+    step = max(1, step);
+    std::vector<Node> nodes(1);
+    memset(&nodes[0], 0, sizeof(Node));
+    std::vector<int> reducible[OCTREE_DEPTH];
+    int leaves = 0;
+    for (int y = 0; y < surface.height; y += step) {
+        const _RGBQUAD* row = surface.Row(y);
+        for (int x = 0; x < surface.width; x += step) {
+            const _RGBQUAD& p = row[x];
+            int node = 0;
+            for (int level = 0; level < OCTREE_DEPTH && !nodes[node].leaf; level++) {
+                int shift = 7 - level;
+                int child = (((p.r >> shift) & 1) << 2) | (((p.g >> shift) & 1) << 1) | ((p.b >> shift) & 1);
+                if (nodes[node].children[child] == 0) {
+                    Node fresh;
+                    memset(&fresh, 0, sizeof(fresh));
+                    fresh.leaf = level == OCTREE_DEPTH - 1;
+                    nodes[node].children[child] = (int)nodes.size();
+                    if (fresh.leaf) {
+                        leaves++;
+                    }
+                    else {
+                        reducible[level + 1].push_back((int)nodes.size());
+                    }
+                    nodes.push_back(fresh);
+                }
+                node = nodes[node].children[child];
+            }
+            Node& n = nodes[node];
+            n.count++;
+            n.r += p.r;
+            n.g += p.g;
+            n.b += p.b;
+        }
+    }
+    // 中间节点的像素数是子树的总和，合并时挑像素最少的
+    std::vector<DWORD> totals(nodes.size(), 0);
+    for (size_t i = nodes.size(); i-- > 0;) {
+        totals[i] += nodes[i].count;
+        for (int c = 0; c < 8; c++) {
+            if (nodes[i].children[c] != 0) {
+                totals[i] += totals[nodes[i].children[c]];
+            }
+        }
+    }
+    reducible[0].push_back(0);
+    // 合并不改变节点自己的像素数，每层按像素数从多到少排一次序，之后从末尾取就是最少的
+    for (int level = 0; level < OCTREE_DEPTH; level++) {
+        std::sort(reducible[level].begin(), reducible[level].end(), [&totals](int a, int b) {
+            return totals[a] > totals[b];
+        });
+    }
+    while (leaves > colors) {
+        int level = OCTREE_DEPTH - 1;
+        while (level > 0 && reducible[level].empty()) {
+            level--;
+        }
+        std::vector<int>& list = reducible[level];
+        if (list.empty()) {
+            break;
+        }
+        int index = list.back();
+        list.pop_back();
+        Node& n = nodes[index];
+        int merged = 0;
+        for (int c = 0; c < 8; c++) {
+            int child = n.children[c];
+            if (child != 0) {
+                n.count += nodes[child].count;
+                n.r += nodes[child].r;
+                n.g += nodes[child].g;
+                n.b += nodes[child].b;
+                n.children[c] = 0;
+                merged++;
+            }
+        }
+        n.leaf = true;
+        leaves -= merged - 1;
+    }
+    // 合并掉的子节点从根不再可达，从根出发收集剩下的叶子
+    std::vector<int> stack(1, 0);
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+        const Node& n = nodes[index];
+        if (n.leaf) {
+            if (n.count > 0) {
+                _RGBQUAD color;
+                color.r = (BYTE)((n.r + n.count / 2) / n.count);
+                color.g = (BYTE)((n.g + n.count / 2) / n.count);
+                color.b = (BYTE)((n.b + n.count / 2) / n.count);
+                color.a = 255;
+                palette.colors.push_back(color);
+            }
+            continue;
+        }
+        for (int c = 7; c >= 0; c--) {
+            if (n.children[c] != 0) {
+                stack.push_back(n.children[c]);
+            }
+        }
+    }
+    palette.BuildInverse();
+}
+
+// 每个像素换成调色板里最近的颜色（查逆调色板表），alpha 不变
+inline void MapToPalette(Surface& surface, const Palette& palette) {
+    if (palette.colors.empty()) {
+        return;
+    }
+    ForEachPixel(surface, [&palette](_RGBQUAD& pixel) {
+        const _RGBQUAD& c = palette.colors[palette.Nearest(pixel)];
+        pixel.b = c.b;
+        pixel.g = c.g;
+        pixel.r = c.r;
+    });
+}
+
+// Floyd–Steinberg 误差扩散到调色板：误差按 7/16、3/16、5/16、1/16 分给右、左下、下、右下
+// 第 y 行的第 x 个像素只依赖第 y-1 行前 x+2 个像素的结果，所以按波前并行：各线程按顺序领取下一行，
+// 每处理完一段就公布进度，下一行追在上一行后面两个像素以外。行按顺序领取，前一行一定已经有线程在做，
+// 即使各段不能同时运行（线程池忙、嵌套调用时串行执行）也不会互相等死。所有行都从左往右扫描 ——
+// 蛇形扫描会让下一行要等上一行整行做完才能开始，波前就退化成串行了
+const int DITHER_PROGRESS_STEP = 64;
+inline void DitherToPalette(Surface& surface, const Palette& palette) {
+    if (surface.Empty() || palette.colors.empty()) {
+        return;
+    }
+    int w = surface.width;
+    int h = surface.height;
+    int workers = min(WorkerCount(), h);
+    // 误差行按环形缓冲复用：第 y 行读 slots[y % ring]、写 slots[(y + 1) % ring]，值是误差的 16 倍
+    int ring = workers + 2;
+    int pitch = (w + 2) * 3;
+    std::vector<int> slots((size_t)ring * pitch, 0);
+    std::vector<std::atomic<int>> progress(h);
+    for (int y = 0; y < h; y++) {
+        progress[y].store(0);
+    }
+    std::atomic<int> nextRow(0);
+    ParallelFor(workers, [&surface, &palette, &slots, &progress, &nextRow, w, h, ring, pitch](int, int) {
+        for (int y = nextRow.fetch_add(1); y < h; y = nextRow.fetch_add(1)) {
+            int* incoming = &slots[(size_t)(y % ring) * pitch] + 3;
+            int* outgoing = &slots[(size_t)((y + 1) % ring) * pitch] + 3;
+            // 写下一行的误差前先清空。没做完的行总是连续的最后几行，同时最多 workers 行，
+            // 这个槽位上一次是第 y + 1 - ring 行用的，它早已做完
+            memset(outgoing - 3, 0, pitch * sizeof(int));
+            PRGBQUAD row = surface.Row(y);
+            int carry[3] = { 0, 0, 0 };
+            int ready = y == 0 ? w : 0;
+            for (int x = 0; x < w; x++) {
+                int need = min(w, x + 2);
+                while (ready < need) {
+                    ready = progress[y - 1].load(std::memory_order_acquire);
+                    if (ready < need) {
+                        std::this_thread::yield();
+                    }
+                }
+                BYTE* c = (BYTE*)(row + x);
+                int value[3];
+                for (int i = 0; i < 3; i++) {
+                    int v = (c[i] * 16 + incoming[x * 3 + i] + carry[i] + 8) >> 4;
+                    value[i] = max(0, min(255, v));
+                }
+                const _RGBQUAD& chosen = palette.colors[palette.Nearest(value[2], value[1], value[0])];
+                const BYTE* q = (const BYTE*)&chosen;
+                for (int i = 0; i < 3; i++) {
+                    int error = value[i] - q[i];
+                    carry[i] = error * 7;
+                    outgoing[(x - 1) * 3 + i] += error * 3;
+                    outgoing[x * 3 + i] += error * 5;
+                    outgoing[(x + 1) * 3 + i] += error;
+                    c[i] = q[i];
+                }
+                if ((x + 1) % DITHER_PROGRESS_STEP == 0) {
+                    progress[y].store(x + 1, std::memory_order_release);
+                }
+            }
+            progress[y].store(w, std::memory_order_release);
+        }
+    }, 1);
+}
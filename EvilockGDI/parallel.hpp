@@ -0,0 +1,157 @@
+﻿#pragma once
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 参与计算的线程数（包括调用线程）
+inline int WorkerCount() {
+    static const int count = max(1, (int)std::thread::hardware_concurrency());
+    return count;
+}
+
+// 一次 ParallelFor 调用：chunks 段工作，各线程用 next 领取段号，finished 记录完成的段数
+struct ParallelJob {
+    std::function<void(int)> run;
+    int chunks;
+    std::atomic<int> next;
+    std::atomic<int> finished;
+    int users;                  // 正在领取这个任务的工作线程数（受 WorkerPool::lock 保护）
+
+    ParallelJob(std::function<void(int)> run, int chunks) : run(std::move(run)), chunks(chunks), next(0), finished(0), users(0) {
+    }
+};
+
+// 常驻的工作线程池：WorkerCount() - 1 个线程在第一次使用时创建，之后一直复用，
+// 每次 ParallelFor 只是把任务放进队列再唤醒它们，不再反复创建、销毁线程
+class WorkerPool {
+public:
+    static WorkerPool& Instance() {
+        static WorkerPool pool;
+        return pool;
+    }
+    // 当前线程是不是池里的工作线程（工作线程里再调用 ParallelFor 时直接串行执行，避免互相等待）
+    static bool& InWorker() {
+        static thread_local bool inWorker = false;
+        return inWorker;
+    }
+
+    // 执行 job 的所有段，调用线程也一起领取，全部完成后返回
+    void Run(ParallelJob& job) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(&job);
+        }
+        wake.notify_all();
+        Work(job);
+        std::unique_lock<std::mutex> guard(lock);
+        idle.wait(guard, [&job]() {
+            return job.finished.load() == job.chunks && job.users == 0;
+        });
+        auto it = std::find(jobs.begin(), jobs.end(), &job);
+        if (it != jobs.end()) {
+            jobs.erase(it);
+        }
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable wake;   // 有新任务
+    std::condition_variable idle;   // 有任务做完
+    std::deque<ParallelJob*> jobs;
+    std::vector<std::thread> threads;
+    bool stopping;
+
+    WorkerPool() : stopping(false) {
+        for (int i = 1; i < WorkerCount(); i++) {
+            threads.emplace_back([this]() {
+                Loop();
+            });
+        }
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    // 领取并执行段，直到没有剩下的段
+    void Work(ParallelJob& job) {
+        for (;;) {
+            int chunk = job.next.fetch_add(1);
+            if (chunk >= job.chunks) {
+                return;
+            }
+            job.run(chunk);
+            if (job.finished.fetch_add(1) + 1 == job.chunks) {
+                std::lock_guard<std::mutex> guard(lock);
+                idle.notify_all();
+            }
+        }
+    }
+
+    void Loop() {
+        InWorker() = true;
+        for (;;) {
+            ParallelJob* job;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [this]() {
+                    return stopping || !jobs.empty();
+                });
+                if (stopping) {
+                    return;
+                }
+                job = jobs.front();
+                if (job->next.load() >= job->chunks) {
+                    // 段都被领完了，从队列里拿掉（调用线程等的是 finished，不依赖队列）
+                    jobs.pop_front();
+                    continue;
+                }
+                job->users++;
+            }
+            Work(*job);
+            std::lock_guard<std::mutex> guard(lock);
+            job->users--;
+            if (job->users == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+// 把 [0, count) 平均分成若干段，分给多个线程执行 body(begin, end)，全部完成后返回
+// 每段至少 grain 个元素，工作量太小时直接在调用线程里执行
+template <typename Body>
+inline void ParallelFor(int count, Body body, int grain = 16) {
+    if (count <= 0) {
+        return;
+    }
+    int chunks = min(WorkerCount(), (count + grain - 1) / max(1, grain));
+    if (chunks <= 1 || WorkerPool::InWorker()) {
+        body(0, count);
+        return;
+    }
+    ParallelJob job([&body, count, chunks](int chunk) {
+        body((int)((long long)count * chunk / chunks), (int)((long long)count * (chunk + 1) / chunks));
+    }, chunks);
+    WorkerPool::Instance().Run(job);
+}
+
+// 按行并行处理 width 像素宽的区域：每段至少 PARALLEL_MIN_PIXELS 个像素，
+// 小区域（例如单个字形）直接在调用线程里执行，不值得唤醒其他线程
+const int PARALLEL_MIN_PIXELS = 16384;
+template <typename Body>
+inline void ParallelForRows(int rows, int width, Body body) {
+    ParallelFor(rows, body, max(1, PARALLEL_MIN_PIXELS / max(1, width)));
+}
@@ -0,0 +1,192 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <vector>
+
+// 路径：直线、二次/三次贝塞尔曲线和 Catmull-Rom 样条组成的若干条轮廓
+// 曲线按容差自适应展平成折线，之后可以按弧长等间距取点
+class Path {
+public:
+    std::vector<std::vector<POINTFLOAT>> contours;  // 展平后的折线，每条轮廓一段
+    std::vector<bool> closedContours;               // 对应轮廓是否闭合
+
+    Path(float tolerance = 0.25f) : tolerance(tolerance) {
+    }
+
+    // 展平容差（像素）：折线和真实曲线之间的最大距离
+    void SetTolerance(float newTolerance) {
+        tolerance = max(0.01f, newTolerance);
+    }
+    void Clear() {
+        contours.clear();
+        closedContours.clear();
+    }
+    bool Empty() const {
+        return contours.empty();
+    }
+
+    void MoveTo(float x, float y) {
+        contours.emplace_back();
+        closedContours.push_back(false);
+        contours.back().push_back(Point(x, y));
+    }
+    void LineTo(float x, float y) {
+        Current().push_back(Point(x, y));
+    }
+    void QuadTo(float cx, float cy, float x, float y) {
+        POINTFLOAT p0 = Current().back();
+        FlattenQuad(p0, Point(cx, cy), Point(x, y), 0);
+    }
+    void CubicTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
+        POINTFLOAT p0 = Current().back();
+        FlattenCubic(p0, Point(c1x, c1y), Point(c2x, c2y), Point(x, y), 0);
+    }
+    // 从当前点出发依次经过 points 的 Catmull-Rom 样条，每一段转换成等价的三次贝塞尔曲线
+    void CatmullRomTo(const POINTFLOAT* points, int count) {
+        if (count <= 0) {
+            return;
+        }
+        std::vector<POINTFLOAT> knots;
+        knots.reserve(count + 1);
+        knots.push_back(Current().back());
+        knots.insert(knots.end(), points, points + count);
+        int last = (int)knots.size() - 1;
+        for (int i = 0; i < last; i++) {
+            const POINTFLOAT& p0 = knots[max(i - 1, 0)];
+            const POINTFLOAT& p1 = knots[i];
+            const POINTFLOAT& p2 = knots[i + 1];
+            const POINTFLOAT& p3 = knots[min(i + 2, last)];
+            FlattenCubic(p1,
+                Point(p1.x + (p2.x - p0.x) / 6.0f, p1.y + (p2.y - p0.y) / 6.0f),
+                Point(p2.x - (p3.x - p1.x) / 6.0f, p2.y - (p3.y - p1.y) / 6.0f),
+                p2, 0);
+        }
+    }
+    void Close() {
+        if (!contours.empty()) {
+            closedContours.back() = true;
+        }
+    }
+
+    float Length() const {
+        float total = 0.0f;
+        for (size_t c = 0; c < contours.size(); c++) {
+            total += ContourLength(c);
+        }
+        return total;
+    }
+
+    // 按弧长等间距取点：间距不超过 spacing 的最少点数，点在每条轮廓上严格均匀分布
+    // 开放轮廓包含两个端点；angles 不为空时同时输出每个点的切线方向（弧度）
+    void Resample(float spacing, std::vector<POINTFLOAT>& points, std::vector<float>* angles = NULL) const {
+        spacing = max(spacing, 0.01f);
+        for (size_t c = 0; c < contours.size(); c++) {
+            std::vector<POINTFLOAT> poly = contours[c];
+            if (closedContours[c] && poly.size() > 1) {
+                poly.push_back(poly.front());
+            }
+            float length = ContourLength(c);
+            if (poly.size() < 2 || length <= 0.0f) {
+                if (!poly.empty()) {
+                    points.push_back(poly.front());
+                    if (angles != NULL) {
+                        angles->push_back(0.0f);
+                    }
+                }
+                continue;
+            }
+
+            int intervals = max(1, (int)ceilf(length / spacing - 1e-4f));
+            int count = closedContours[c] ? intervals : intervals + 1;
+            float step = length / intervals;
+            size_t segment = 0;
+            float segmentStart = 0.0f;
+            float segmentLength = Distance(poly[0], poly[1]);
+            for (int k = 0; k < count; k++) {
+                float target = min(step * k, length);
+                while (segment + 2 < poly.size() && segmentStart + segmentLength < target) {
+                    segmentStart += segmentLength;
+                    segment++;
+                    segmentLength = Distance(poly[segment], poly[segment + 1]);
+                }
+                const POINTFLOAT& a = poly[segment];
+                const POINTFLOAT& b = poly[segment + 1];
+                float t = segmentLength > 0.0f ? (target - segmentStart) / segmentLength : 0.0f;
+                t = max(0.0f, min(1.0f, t));
+                points.push_back(Point(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t));
+                if (angles != NULL) {
+                    angles->push_back(atan2f(b.y - a.y, b.x - a.x));
+                }
+            }
+        }
+    }
+
+private:
+    float tolerance;
+
+    static POINTFLOAT Point(float x, float y) {
+        POINTFLOAT p = { x, y };
+        return p;
+    }
+    static float Distance(const POINTFLOAT& a, const POINTFLOAT& b) {
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        return sqrtf(dx * dx + dy * dy);
+    }
+    // 点 p 到直线 a-b 的距离
+    static float DistanceToChord(const POINTFLOAT& p, const POINTFLOAT& a, const POINTFLOAT& b) {
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float length = sqrtf(dx * dx + dy * dy);
+        if (length < 1e-6f) {
+            return Distance(p, a);
+        }
+        return fabsf((p.x - a.x) * dy - (p.y - a.y) * dx) / length;
+    }
+    std::vector<POINTFLOAT>& Current() {
+        if (contours.empty()) {
+            MoveTo(0.0f, 0.0f);
+        }
+        return contours.back();
+    }
+    float ContourLength(size_t c) const {
+        const std::vector<POINTFLOAT>& poly = contours[c];
+        float total = 0.0f;
+        for (size_t i = 1; i < poly.size(); i++) {
+            total += Distance(poly[i - 1], poly[i]);
+        }
+        if (closedContours[c] && poly.size() > 1) {
+            total += Distance(poly.back(), poly.front());
+        }
+        return total;
+    }
+
+    // 控制点离弦足够近时直接连线，否则在 t = 0.5 处二分（de Casteljau）
+    void FlattenQuad(const POINTFLOAT& p0, const POINTFLOAT& p1, const POINTFLOAT& p2, int depth) {
+        if (depth >= 16 || DistanceToChord(p1, p0, p2) * 0.5f <= tolerance) {
+            Current().push_back(p2);
+            return;
+        }
+        POINTFLOAT a = Point((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f);
+        POINTFLOAT b = Point((p1.x + p2.x) * 0.5f, (p1.y + p2.y) * 0.5f);
+        POINTFLOAT m = Point((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f);
+        FlattenQuad(p0, a, m, depth + 1);
+        FlattenQuad(m, b, p2, depth + 1);
+    }
+    void FlattenCubic(const POINTFLOAT& p0, const POINTFLOAT& p1, const POINTFLOAT& p2, const POINTFLOAT& p3, int depth) {
+        // 曲线到弦的距离不超过控制点到弦距离的 3/4
+        float flatness = max(DistanceToChord(p1, p0, p3), DistanceToChord(p2, p0, p3)) * 0.75f;
+        if (depth >= 16 || flatness <= tolerance) {
+            Current().push_back(p3);
+            return;
+        }
+        POINTFLOAT a = Point((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f);
+        POINTFLOAT b = Point((p1.x + p2.x) * 0.5f, (p1.y + p2.y) * 0.5f);
+        POINTFLOAT c = Point((p2.x + p3.x) * 0.5f, (p2.y + p3.y) * 0.5f);
+        POINTFLOAT ab = Point((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f);
+        POINTFLOAT bc = Point((b.x + c.x) * 0.5f, (b.y + c.y) * 0.5f);
+        POINTFLOAT m = Point((ab.x + bc.x) * 0.5f, (ab.y + bc.y) * 0.5f);
+        FlattenCubic(p0, a, ab, m, depth + 1);
+        FlattenCubic(m, bc, c, p3, depth + 1);
+    }
+};
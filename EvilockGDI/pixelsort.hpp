@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <vector>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "transpose.hpp"
+
+// 像素排序（故障艺术效果）：一行（列）中排序键落在 [low, high] 内的连续像素组成一段，每段按键值重新排列
+enum SortKey {
+    SORT_LUMA,          // 亮度
+    SORT_HUE,           // 色相（0～255 对应 0°～360°）
+    SORT_SATURATION     // 饱和度
+};
+
+// 像素的 8 位排序键
+inline BYTE PixelSortKey(const _RGBQUAD& p, SortKey key) {
+    if (key == SORT_LUMA) {
+        return (BYTE)((p.b * 29 + p.g * 150 + p.r * 77 + 128) >> 8);
+    }
+    int high = max(p.r, max(p.g, p.b));
+    int low = min(p.r, min(p.g, p.b));
+    int delta = high - low;
+    if (delta == 0) {
+        return 0;
+    }
+    if (key == SORT_SATURATION) {
+        return (BYTE)(delta * 255 / high);
+    }
+    int hue;
+    if (high == p.r) {
+        hue = 43 * (p.g - p.b) / delta;
+    }
+    else if (high == p.g) {
+        hue = 85 + 43 * (p.b - p.r) / delta;
+    }
+    else {
+        hue = 171 + 43 * (p.r - p.g) / delta;
+    }
+    return (BYTE)(hue & 255);
+}
+
+// 短的段直接插入排序，长的段用 256 个桶的计数排序（稳定，和段长成线性）
+const int PIXEL_SORT_SMALL_RUN = 48;
+
+// 对 pixels 中的 count 个像素按 keys 排序；scratch 至少能放 count 个像素
+inline void SortRun(PRGBQUAD pixels, BYTE* keys, int count, bool descending, _RGBQUAD* scratch) {
+    if (count < 2) {
+        return;
+    }
+    if (count <= PIXEL_SORT_SMALL_RUN) {
+        for (int i = 1; i < count; i++) {
+            _RGBQUAD p = pixels[i];
+            BYTE k = keys[i];
+            int j = i - 1;
+            while (j >= 0 && (descending ? keys[j] < k : keys[j] > k)) {
+                pixels[j + 1] = pixels[j];
+                keys[j + 1] = keys[j];
+                j--;
+            }
+            pixels[j + 1] = p;
+            keys[j + 1] = k;
+        }
+        return;
+    }
+    int offsets[256] = { 0 };
+    for (int i = 0; i < count; i++) {
+        offsets[keys[i]]++;
+    }
+    int total = 0;
+    for (int i = 0; i < 256; i++) {
+        int bucket = descending ? 255 - i : i;
+        int n = offsets[bucket];
+        offsets[bucket] = total;
+        total += n;
+    }
+    for (int i = 0; i < count; i++) {
+        scratch[offsets[keys[i]]++] = pixels[i];
+    }
+    memcpy(pixels, scratch, count * sizeof(_RGBQUAD));
+}
+
+// 排序用的临时缓冲，每个线程一份，在它处理的各行（列）之间复用
+struct PixelSortBuffers {
+    std::vector<BYTE> keys;
+    std::vector<_RGBQUAD> scratch;
+};
+
+// 对一行 length 个像素做像素排序
+inline void PixelSortLine(PRGBQUAD line, int length, SortKey key, BYTE low, BYTE high, bool descending, PixelSortBuffers& buffers) {
+    std::vector<BYTE>& keys = buffers.keys;
+    keys.resize(length);
+    buffers.scratch.resize(length);
+    for (int i = 0; i < length; i++) {
+        keys[i] = PixelSortKey(line[i], key);
+    }
+    int i = 0;
+    while (i < length) {
+        if (keys[i] < low || keys[i] > high) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while (i < length && keys[i] >= low && keys[i] <= high) {
+            i++;
+        }
+        SortRun(line + start, &keys[start], i - start, descending, buffers.scratch.data());
+    }
+}
+
+// 逐行像素排序，各行分给多个线程
+inline void PixelSortRows(Surface& surface, SortKey key = SORT_LUMA, BYTE low = 64, BYTE high = 255, bool descending = false) {
+    ParallelFor(surface.height, [&surface, key, low, high, descending](int begin, int end) {
+        PixelSortBuffers buffers;
+        for (int y = begin; y < end; y++) {
+            PixelSortLine(surface.Row(y), surface.width, key, low, high, descending, buffers);
+        }
+    }, 8);
+}
+
+// 逐列像素排序：列带先转置成连续的行再排序（见 ProcessColumnsAsRowsWithState），descending 为 false 时从上到下递增
+inline void PixelSortColumns(Surface& surface, SortKey key = SORT_LUMA, BYTE low = 64, BYTE high = 255, bool descending = false) {
+    ProcessColumnsAsRowsWithState<PixelSortBuffers>(surface, [key, low, high, descending](PRGBQUAD column, int length, PixelSortBuffers& buffers) {
+        PixelSortLine(column, length, key, low, high, descending, buffers);
+    });
+}
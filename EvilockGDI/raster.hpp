@@ -0,0 +1,331 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <vector>
+#include "surface.hpp"
+
+// 抗锯齿矢量光栅化：直线、折线、圆和圆弧
+// 每次绘制先把覆盖率累加到包围盒大小的缓冲区里（取最大值，折线拐角不会重复混合），
+// 再按行把有覆盖的那一段用 BlendMaskSpan 一次混合到表面上
+class Rasterizer {
+public:
+    Rasterizer(Surface& target) : target(target), pixel(0xFFFFFFFF), width(1.0f), originX(0), originY(0) {
+    }
+
+    void SetColor(COLORREF color, BYTE alpha = 255) {
+        pixel = ToPixel(color, alpha);
+    }
+    // 线宽（像素），不大于 1 时按细线（吴小林算法）绘制
+    void SetWidth(float newWidth) {
+        width = max(0.0f, newWidth);
+    }
+    // 设置绘制坐标的原点：坐标 (x, y) 会画到表面的 (x - originX, y - originY) 处
+    void SetOrigin(int x, int y) {
+        originX = x;
+        originY = y;
+    }
+
+    void DrawLine(float x0, float y0, float x1, float y1) {
+        POINTFLOAT points[2] = { { x0, y0 }, { x1, y1 } };
+        DrawPolyline(points, 2);
+    }
+    void DrawPolyline(const POINTFLOAT* points, int count, bool closed = false) {
+        if (count < 2) {
+            return;
+        }
+        float pad = width * 0.5f + 1.0f;
+        float left = points[0].x, top = points[0].y, right = left, bottom = top;
+        for (int i = 1; i < count; i++) {
+            left = min(left, points[i].x);
+            top = min(top, points[i].y);
+            right = max(right, points[i].x);
+            bottom = max(bottom, points[i].y);
+        }
+        if (!Begin(left - pad, top - pad, right + pad, bottom + pad)) {
+            return;
+        }
+        int segments = closed ? count : count - 1;
+        for (int i = 0; i < segments; i++) {
+            const POINTFLOAT& a = points[i];
+            const POINTFLOAT& b = points[(i + 1) % count];
+            if (width <= 1.0f) {
+                AddHairline(a.x - originX, a.y - originY, b.x - originX, b.y - originY);
+            }
+            else {
+                AddCapsule(a.x - originX, a.y - originY, b.x - originX, b.y - originY, width * 0.5f);
+            }
+        }
+        End();
+    }
+    void DrawCircle(float cx, float cy, float radius) {
+        DrawArc(cx, cy, radius, 0.0f, 360.0f);
+    }
+    // 画圆弧，角度单位为度，从 startAngle 开始顺时针（屏幕坐标 y 向下）扫过 sweepAngle
+    void DrawArc(float cx, float cy, float radius, float startAngle, float sweepAngle) {
+        float halfWidth = max(0.5f, width * 0.5f);
+        float pad = radius + halfWidth + 1.0f;
+        if (!Begin(cx - pad, cy - pad, cx + pad, cy + pad)) {
+            return;
+        }
+        AddRing(cx - originX, cy - originY, radius, halfWidth, startAngle, sweepAngle, width <= 1.0f && width > 0.0f ? width : 1.0f, false);
+        End();
+    }
+    void FillCircle(float cx, float cy, float radius) {
+        float pad = radius + 1.0f;
+        if (!Begin(cx - pad, cy - pad, cx + pad, cy + pad)) {
+            return;
+        }
+        AddRing(cx - originX, cy - originY, radius * 0.5f, radius * 0.5f, 0.0f, 360.0f, 1.0f, true);
+        End();
+    }
+
+private:
+    Surface& target;
+    DWORD pixel;
+    float width;
+    int originX;
+    int originY;
+
+    // 覆盖率缓冲区，对应表面上 [covLeft, covLeft + covWidth) x [covTop, covTop + covHeight)
+    std::vector<BYTE> coverage;
+    std::vector<int> rowMin;
+    std::vector<int> rowMax;
+    int covLeft = 0;
+    int covTop = 0;
+    int covWidth = 0;
+    int covHeight = 0;
+
+    bool Begin(float left, float top, float right, float bottom) {
+        int x0 = max(0, (int)floorf(left - originX));
+        int y0 = max(0, (int)floorf(top - originY));
+        int x1 = min(target.width, (int)ceilf(right - originX) + 1);
+        int y1 = min(target.height, (int)ceilf(bottom - originY) + 1);
+        if (x0 >= x1 || y0 >= y1) {
+            return false;
+        }
+        covLeft = x0;
+        covTop = y0;
+        covWidth = x1 - x0;
+        covHeight = y1 - y0;
+        coverage.assign((size_t)covWidth * covHeight, 0);
+        rowMin.assign(covHeight, covWidth);
+        rowMax.assign(covHeight, 0);
+        return true;
+    }
+    void End() {
+        for (int y = 0; y < covHeight; y++) {
+            if (rowMin[y] >= rowMax[y]) {
+                continue;
+            }
+            PRGBQUAD row = target.Row(covTop + y) + covLeft;
+            const BYTE* mask = &coverage[(size_t)y * covWidth];
+            BlendMaskSpan(row + rowMin[y], pixel, mask + rowMin[y], rowMax[y] - rowMin[y]);
+        }
+    }
+    // 在表面坐标 (x, y) 处记录覆盖率 value（0～1），取已有值和新值中较大的一个
+    void Plot(int x, int y, float value) {
+        x -= covLeft;
+        y -= covTop;
+        if (x < 0 || y < 0 || x >= covWidth || y >= covHeight || value <= 0.0f) {
+            return;
+        }
+        BYTE v = (BYTE)(min(value, 1.0f) * 255.0f + 0.5f);
+        BYTE& c = coverage[(size_t)y * covWidth + x];
+        if (v > c) {
+            c = v;
+        }
+        rowMin[y] = min(rowMin[y], x);
+        rowMax[y] = max(rowMax[y], x + 1);
+    }
+
+    // 表面第 y 行 [x0, x1) 全部覆盖
+    void PlotFull(int x0, int x1, int y) {
+        x0 = max(x0 - covLeft, 0);
+        x1 = min(x1 - covLeft, covWidth);
+        y -= covTop;
+        if (x0 >= x1 || y < 0 || y >= covHeight) {
+            return;
+        }
+        memset(&coverage[(size_t)y * covWidth + x0], 255, x1 - x0);
+        rowMin[y] = min(rowMin[y], x0);
+        rowMax[y] = max(rowMax[y], x1);
+    }
+
+    // 吴小林抗锯齿细线，亮度按线宽缩放
+    void AddHairline(float x0, float y0, float x1, float y1) {
+        float intensity = width > 0.0f ? width : 1.0f;
+        bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+        if (steep) {
+            float t = x0; x0 = y0; y0 = t;
+            t = x1; x1 = y1; y1 = t;
+        }
+        if (x0 > x1) {
+            float t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        // 像素中心在 (i + 0.5)，先平移到整数中心再按经典算法处理
+        x0 -= 0.5f; y0 -= 0.5f; x1 -= 0.5f; y1 -= 0.5f;
+        float dx = x1 - x0;
+        float gradient = dx > 0.0f ? (y1 - y0) / dx : 1.0f;
+
+        int xStart = (int)floorf(x0 + 0.5f);
+        int xEnd = (int)floorf(x1 + 0.5f);
+        float y = y0 + gradient * (xStart - x0);
+        for (int x = xStart; x <= xEnd; x++) {
+            // 两端按线段在该列中实际覆盖的长度衰减
+            float span = 1.0f;
+            if (x == xStart) {
+                span = min(span, (xStart + 0.5f) - x0);
+            }
+            if (x == xEnd) {
+                span = min(span, x1 - (xEnd - 0.5f));
+            }
+            if (xStart == xEnd) {
+                span = x1 - x0;
+            }
+            int yi = (int)floorf(y);
+            float f = y - yi;
+            float a = (1.0f - f) * span * intensity;
+            float b = f * span * intensity;
+            if (steep) {
+                Plot(yi, x, a);
+                Plot(yi + 1, x, b);
+            }
+            else {
+                Plot(x, yi, a);
+                Plot(x, yi + 1, b);
+            }
+            y += gradient;
+        }
+    }
+
+    // 线段 a-b 加圆头、半宽 r 的胶囊形。每行先解析求出覆盖范围，中间全覆盖的部分不必逐像素求距离
+    void AddCapsule(float ax, float ay, float bx, float by, float r) {
+        float dx = bx - ax;
+        float dy = by - ay;
+        float length = sqrtf(dx * dx + dy * dy);
+        float ux = length > 0.0f ? dx / length : 1.0f;
+        float uy = length > 0.0f ? dy / length : 0.0f;
+
+        float outer = r + 0.5f;
+        float inner = r - 0.5f;
+        int y0 = max(covTop, (int)floorf(min(ay, by) - outer));
+        int y1 = min(covTop + covHeight, (int)ceilf(max(ay, by) + outer) + 1);
+        for (int y = y0; y < y1; y++) {
+            float yc = y + 0.5f;
+            float outL, outR, inL, inR;
+            if (!CapsuleRowSpan(ax, ay, ux, uy, length, outer, yc, outL, outR)) {
+                continue;
+            }
+            bool hasInner = inner > 0.0f && CapsuleRowSpan(ax, ay, ux, uy, length, inner, yc, inL, inR);
+            int xa = (int)floorf(outL - 0.5f);
+            int xb = (int)ceilf(outR - 0.5f);
+            // 内侧范围里的像素中心离线段不超过 r - 0.5，覆盖率为 1
+            int fullL = hasInner ? (int)ceilf(inL - 0.5f) : xb + 1;
+            int fullR = hasInner ? (int)floorf(inR - 0.5f) : xb;
+            if (fullL <= fullR) {
+                PlotFull(fullL, fullR + 1, y);
+            }
+            for (int x = xa; x <= xb; x++) {
+                if (x >= fullL && x <= fullR) {
+                    x = fullR;
+                    continue;
+                }
+                float px = x + 0.5f - ax;
+                float py = yc - ay;
+                float t = max(0.0f, min(length, px * ux + py * uy));
+                float ex = px - t * ux;
+                float ey = py - t * uy;
+                Plot(x, y, outer - sqrtf(ex * ex + ey * ey));
+            }
+        }
+    }
+    // 求水平线 y = yc 和胶囊（线段 + 半径 r）的交集 [left, right]
+    static bool CapsuleRowSpan(float ax, float ay, float ux, float uy, float length, float r, float yc, float& left, float& right) {
+        left = 1e30f;
+        right = -1e30f;
+        // 两端的圆
+        float ends[2][2] = { { ax, ay }, { ax + ux * length, ay + uy * length } };
+        for (int i = 0; i < 2; i++) {
+            float d = yc - ends[i][1];
+            if (fabsf(d) <= r) {
+                float h = sqrtf(r * r - d * d);
+                left = min(left, ends[i][0] - h);
+                right = max(right, ends[i][0] + h);
+            }
+        }
+        // 中间的矩形：0 <= (p - a)·u <= length 且 |(p - a)·n| <= r，n = (-uy, ux)
+        float lo = -1e30f, hi = 1e30f;
+        float py = yc - ay;
+        if (!ClipSlab(ux, py * uy, 0.0f, length, lo, hi) || !ClipSlab(-uy, py * ux, -r, r, lo, hi)) {
+            return left <= right;
+        }
+        left = min(left, ax + lo);
+        right = max(right, ax + hi);
+        return left <= right;
+    }
+    // 把 x 限制在 minValue <= x * k + c <= maxValue 内
+    static bool ClipSlab(float k, float c, float minValue, float maxValue, float& lo, float& hi) {
+        if (fabsf(k) < 1e-6f) {
+            return c >= minValue && c <= maxValue;
+        }
+        float t0 = (minValue - c) / k;
+        float t1 = (maxValue - c) / k;
+        if (t0 > t1) {
+            float t = t0; t0 = t1; t1 = t;
+        }
+        lo = max(lo, t0);
+        hi = min(hi, t1);
+        return lo <= hi;
+    }
+
+    // 圆环（半径 radius，半宽 halfWidth），按角度范围裁剪，两端是平头并做抗锯齿；filled 时画实心圆盘
+    void AddRing(float cx, float cy, float radius, float halfWidth, float startAngle, float sweepAngle, float intensity, bool filled) {
+        bool fullCircle = fabsf(sweepAngle) >= 360.0f;
+        if (sweepAngle < 0.0f) {
+            startAngle += sweepAngle;
+            sweepAngle = -sweepAngle;
+        }
+        float a0 = startAngle * (float)(PI / 180.0);
+        float a1 = (startAngle + sweepAngle) * (float)(PI / 180.0);
+        float sx = cosf(a0), sy = sinf(a0);
+        float ex = cosf(a1), ey = sinf(a1);
+        bool wide = sweepAngle > 180.0f;
+
+        float outer = radius + halfWidth + 0.5f;
+        float inner = radius - halfWidth - 0.5f;
+        int y0 = max(covTop, (int)floorf(cy - outer));
+        int y1 = min(covTop + covHeight, (int)ceilf(cy + outer) + 1);
+        for (int y = y0; y < y1; y++) {
+            float dy = y + 0.5f - cy;
+            if (fabsf(dy) > outer) {
+                continue;
+            }
+            float xo = sqrtf(outer * outer - dy * dy);
+            float xi = (inner > 0.0f && fabsf(dy) < inner) ? sqrtf(inner * inner - dy * dy) : -1.0f;
+            // 圆环和这一行相交成一段（穿过空心时为左右两段）
+            float ranges[2][2] = { { cx - xo, xi >= 0.0f ? cx - xi : cx + xo }, { cx + xi, cx + xo } };
+            int rangeCount = xi >= 0.0f ? 2 : 1;
+            for (int k = 0; k < rangeCount; k++) {
+                int xa = (int)floorf(ranges[k][0] - 0.5f);
+                int xb = (int)ceilf(ranges[k][1] - 0.5f);
+                for (int x = xa; x <= xb; x++) {
+                    float dx = x + 0.5f - cx;
+                    float d = sqrtf(dx * dx + dy * dy);
+                    float value = filled ? outer - d : halfWidth + 0.5f - fabsf(d - radius);
+                    if (value <= 0.0f) {
+                        continue;
+                    }
+                    if (!fullCircle) {
+                        // 到起止两条半径所在直线的有向距离
+                        float ds = sx * dy - sy * dx;
+                        float de = dx * ey - dy * ex;
+                        float edge = wide ? max(ds, de) : min(ds, de);
+                        value = min(value, edge + 0.5f);
+                    }
+                    Plot(x, y, min(value, 1.0f) * intensity);
+                }
+            }
+        }
+    }
+};
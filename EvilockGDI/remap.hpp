@@ -0,0 +1,333 @@
+﻿#pragma once
+#include <Windows.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 坐标重映射：target 的 (x, y) 取 source 在 f(x, y) 处的颜色（双线性插值）
+// 漩涡、鱼眼、隧道、万花筒、镜像、水波都是这一类效果，f 只和参数、尺寸有关，
+// 所以先把 f 烘焙成一张定点偏移表，每帧只需要按表取样一遍，不用逐像素算三角函数
+
+// 偏移表最多的小数位数：偏移量最精细是 13.3 定点数（1/8 像素），short 能表示 ±4095 像素
+// 画面更大时（5K、8K 屏幕）偏移量可能超过这个范围，按宽高中较大的一边减少小数位，保证 short 放得下
+const int REMAP_FRACTION_BITS = 3;
+
+// 宽高为 w x h 时偏移量用的小数位数：偏移量不超过 (max(w, h) - 1) 像素；超过 32768 像素时返回 -1（无法表示）
+inline int RemapFractionBits(int w, int h) {
+    int extent = max(1, max(w, h)) - 1;
+    for (int bits = REMAP_FRACTION_BITS; bits >= 0; bits--) {
+        if (extent <= (SHRT_MAX >> bits)) {
+            return bits;
+        }
+    }
+    return -1;
+}
+
+// 烘焙好的映射：每个像素两个 short (dx, dy)，源坐标 = (x + dx / one, y + dy / one)，one = 1 << fractionBits，
+// 已经限制在画面内
+struct RemapMap {
+    int width;
+    int height;
+    int fractionBits;
+    std::vector<short> offsets;
+
+    RemapMap() : width(0), height(0), fractionBits(REMAP_FRACTION_BITS) {
+    }
+    bool Empty() const {
+        return offsets.empty();
+    }
+};
+
+// 按 mapping(x, y, sx, sy) 烘焙 w x h 的映射表，mapping 给出 (x, y) 要取的源坐标（像素单位，可以越界）
+template <typename MappingFunc>
+inline void BakeRemap(RemapMap& map, int w, int h, MappingFunc mapping) {
+    map.width = max(0, w);
+    map.height = max(0, h);
+    map.fractionBits = RemapFractionBits(w, h);
+    if (map.fractionBits < 0) {
+        map.offsets.clear();
+        return;
+    }
+    map.offsets.resize((size_t)map.width * map.height * 2);
+    const int one = 1 << map.fractionBits;
+    ParallelFor(map.height, [&map, &mapping, w, h, one](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            short* out = &map.offsets[(size_t)y * w * 2];
+            for (int x = 0; x < w; x++) {
+                float sx = (float)x, sy = (float)y;
+                mapping((float)x, (float)y, sx, sy);
+                sx = max(0.0f, min((float)(w - 1), sx));
+                sy = max(0.0f, min((float)(h - 1), sy));
+                out[x * 2] = (short)((int)(sx * one + 0.5f) - x * one);
+                out[x * 2 + 1] = (short)((int)(sy * one + 0.5f) - y * one);
+            }
+        }
+    }, 8);
+}
+
+// 两张同尺寸映射表之间插值：result = a + (b - a) * t / 32（t 为 0～32）
+// 同一个像素在两张表里相差 REMAP_BLEND_LIMIT 像素以上时（例如隧道纹理绕回的接缝）不插值，直接取较近的一张
+const int REMAP_BLEND_STEPS = 32;
+const int REMAP_BLEND_LIMIT = 128;
+inline void BlendRemap(const RemapMap& a, const RemapMap& b, int t, RemapMap& result) {
+    result.width = a.width;
+    result.height = a.height;
+    result.fractionBits = a.fractionBits;
+    result.offsets.resize(a.offsets.size());
+    // 换算成定点数，最多 1023
+    const short limitFixed = (short)((REMAP_BLEND_LIMIT << max(0, a.fractionBits)) - 1);
+    t = max(0, min(REMAP_BLEND_STEPS, t));
+    const short* pa = a.offsets.data();
+    const short* pb = b.offsets.data();
+    short* out = result.offsets.data();
+    const short* nearest = t * 2 < REMAP_BLEND_STEPS ? pa : pb;
+    int count = (int)a.offsets.size();
+    ParallelFor((count + 7) / 8, [pa, pb, out, nearest, count, t, limitFixed](int begin, int end) {
+        const __m128i weight = _mm_set1_epi16((short)t);
+        const __m128i limit = _mm_set1_epi16(limitFixed);
+        int i = begin * 8;
+        int stop = min(count, end * 8);
+        for (; i + 8 <= stop; i += 8) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(pa + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(pb + i));
+            __m128i vn = _mm_loadu_si128((const __m128i*)(nearest + i));
+            // 差值饱和到 16 位，超过限制的位置用 vn；其余差值不超过 1023，乘以 32 不会溢出
+            __m128i diff = _mm_subs_epi16(vb, va);
+            __m128i far0 = _mm_or_si128(_mm_cmpgt_epi16(diff, limit), _mm_cmplt_epi16(diff, _mm_sub_epi16(_mm_setzero_si128(), limit)));
+            __m128i lerp = _mm_add_epi16(va, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(diff, weight), _mm_set1_epi16(REMAP_BLEND_STEPS / 2)), 5));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_or_si128(_mm_and_si128(far0, vn), _mm_andnot_si128(far0, lerp)));
+        }
+        for (; i < stop; i++) {
+            int diff = pb[i] - pa[i];
+            out[i] = abs(diff) > limitFixed ? nearest[i] : (short)(pa[i] + ((diff * t + REMAP_BLEND_STEPS / 2) >> 5));
+        }
+    }, 4096);
+}
+
+// 按映射表取样：target[y][x] = source 在 (x, y) + offset 处的双线性插值
+// source 的尺寸应和映射表相同，target 尺寸不同时重新创建；source 和 target 不能是同一个表面
+// SSE2 没有 gather 指令，四个邻点逐个取出后拼成向量，插值部分每次算两个像素
+inline void Remap(const Surface& source, Surface& target, const RemapMap& map) {
+    if (source.Empty() || map.Empty() || source.width != map.width || source.height != map.height) {
+        return;
+    }
+    int w = source.width;
+    int h = source.height;
+    if (target.width != w || target.height != h) {
+        target.Create(w, h);
+    }
+    const int bits = map.fractionBits;
+    ParallelFor(h, [&source, &target, &map, w, h, bits](int begin, int end) {
+        const int unit = 1 << bits;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16((short)unit);
+        const __m128i round = _mm_set1_epi16((short)(unit * unit / 2));
+        const __m128i shift = _mm_cvtsi32_si128(bits * 2);
+        const int maxX = (w - 1) * unit;
+        const int maxY = (h - 1) * unit;
+        // 取出一个像素的四个邻点和权重，邻点展开成 16 位放在 lane 的低 / 高 64 位
+        auto fetch = [&source, w, h, maxX, maxY, bits, unit](const short* offset, int x, int y, __m128i* corners, int* fx, int* fy) {
+            int sx = max(0, min(maxX, x * unit + offset[0]));
+            int sy = max(0, min(maxY, y * unit + offset[1]));
+            int ix = sx >> bits;
+            int iy = sy >> bits;
+            *fx = sx & (unit - 1);
+            *fy = sy & (unit - 1);
+            const _RGBQUAD* top = source.Row(iy);
+            const _RGBQUAD* bottom = source.Row(min(iy + 1, h - 1));
+            int ix1 = min(ix + 1, w - 1);
+            corners[0] = _mm_cvtsi32_si128((int)top[ix].rgb);
+            corners[1] = _mm_cvtsi32_si128((int)top[ix1].rgb);
+            corners[2] = _mm_cvtsi32_si128((int)bottom[ix].rgb);
+            corners[3] = _mm_cvtsi32_si128((int)bottom[ix1].rgb);
+        };
+        for (int y = begin; y < end; y++) {
+            const short* offsets = &map.offsets[(size_t)y * w * 2];
+            PRGBQUAD dst = target.Row(y);
+            for (int x = 0; x < w; x += 2) {
+                __m128i a[4], b[4];
+                int fxA, fyA, fxB, fyB;
+                fetch(offsets + x * 2, x, y, a, &fxA, &fyA);
+                if (x + 1 < w) {
+                    fetch(offsets + x * 2 + 2, x + 1, y, b, &fxB, &fyB);
+                }
+                else {
+                    b[0] = a[0], b[1] = a[1], b[2] = a[2], b[3] = a[3];
+                    fxB = fxA, fyB = fyA;
+                }
+                __m128i fx = _mm_set_epi16((short)fxB, (short)fxB, (short)fxB, (short)fxB, (short)fxA, (short)fxA, (short)fxA, (short)fxA);
+                __m128i fy = _mm_set_epi16((short)fyB, (short)fyB, (short)fyB, (short)fyB, (short)fyA, (short)fyA, (short)fyA, (short)fyA);
+                __m128i c[4];
+                for (int i = 0; i < 4; i++) {
+                    c[i] = _mm_unpacklo_epi8(_mm_unpacklo_epi32(a[i], b[i]), zero);
+                }
+                // 先水平后竖直，最大值 255 * unit * unit（不超过 255 * 8 * 8），16 位无符号不会溢出
+                __m128i top = _mm_add_epi16(_mm_mullo_epi16(c[0], _mm_sub_epi16(one, fx)), _mm_mullo_epi16(c[1], fx));
+                __m128i bottom = _mm_add_epi16(_mm_mullo_epi16(c[2], _mm_sub_epi16(one, fx)), _mm_mullo_epi16(c[3], fx));
+                __m128i v = _mm_add_epi16(_mm_mullo_epi16(top, _mm_sub_epi16(one, fy)), _mm_mullo_epi16(bottom, fy));
+                v = _mm_srl_epi16(_mm_add_epi16(v, round), shift);
+                __m128i packed = _mm_packus_epi16(v, v);
+                if (x + 1 < w) {
+                    _mm_storel_epi64((__m128i*)(dst + x), packed);
+                }
+                else {
+                    dst[x].rgb = (DWORD)_mm_cvtsi128_si32(packed);
+                }
+            }
+        }
+    }, 8);
+}
+
+// 内置的映射效果，parameter 的含义见 RemapCoordinate
+enum RemapEffect {
+    REMAP_SWIRL,            // 漩涡：parameter 为中心处的旋转角度（弧度），向外逐渐减小到 0
+    REMAP_FISHEYE,          // 鱼眼：parameter 为放大强度（-1～1，负数为桶形收缩）
+    REMAP_TUNNEL,           // 隧道：parameter 为向前移动的距离（像素）
+    REMAP_KALEIDOSCOPE,     // 万花筒（六瓣）：parameter 为取样扇区的旋转角度（弧度）
+    REMAP_MIRROR,           // 左右镜像：parameter 为对称轴位置（0～1，相对宽度）
+    REMAP_RIPPLE            // 水波：parameter 为相位（弧度）
+};
+
+// 内置效果的映射函数：w x h 画面上 (x, y) 要取的源坐标
+inline void RemapCoordinate(RemapEffect effect, float parameter, int w, int h, float x, float y, float& sx, float& sy) {
+    const float pi = 3.14159265f;
+    float cx = (w - 1) * 0.5f;
+    float cy = (h - 1) * 0.5f;
+    float dx = x - cx;
+    float dy = y - cy;
+    float radius = max(1.0f, min(w, h) * 0.5f);
+    float r = sqrtf(dx * dx + dy * dy);
+    sx = x;
+    sy = y;
+    switch (effect) {
+    case REMAP_SWIRL:
+        if (r < radius) {
+            float k = 1.0f - r / radius;
+            float angle = parameter * k * k;
+            float c = cosf(angle), s = sinf(angle);
+            sx = cx + dx * c - dy * s;
+            sy = cy + dx * s + dy * c;
+        }
+        break;
+    case REMAP_FISHEYE:
+        if (r < radius) {
+            float n = r / radius;
+            float scale = 1.0f + parameter * (n * n - 1.0f);
+            sx = cx + dx * scale;
+            sy = cy + dy * scale;
+        }
+        break;
+    case REMAP_TUNNEL: {
+        // 角度展开成横坐标，距离的倒数是深度，深度加上移动距离后在源图上绕回
+        float u = (atan2f(dy, dx) / (2.0f * pi) + 0.5f) * (w - 1);
+        float v = radius * 32.0f / max(r, 1.0f) + parameter;
+        v = fmodf(v, (float)h);
+        sx = u;
+        sy = v < 0.0f ? v + h : v;
+        break;
+    }
+    case REMAP_KALEIDOSCOPE: {
+        const float sector = pi / 3.0f;
+        float angle = fmodf(atan2f(dy, dx) + 2.0f * pi, sector);
+        if (angle > sector * 0.5f) {
+            angle = sector - angle;
+        }
+        sx = cx + r * cosf(angle + parameter);
+        sy = cy + r * sinf(angle + parameter);
+        break;
+    }
+    case REMAP_MIRROR: {
+        float axis = parameter * (w - 1);
+        if (x > axis) {
+            sx = 2.0f * axis - x;
+        }
+        break;
+    }
+    case REMAP_RIPPLE:
+        if (r > 0.0f) {
+            float offset = 6.0f * sinf(r / 12.0f - parameter);
+            sx = x + dx / r * offset;
+            sy = y + dy / r * offset;
+        }
+        break;
+    }
+}
+
+// 映射表缓存：按 (效果, 参数, 尺寸) 保存烘焙好的表，超过 capacity 张时丢掉最久没用的
+// step 大于 0 时参数按 step 量化成关键值，取用时烘焙（或取出）相邻两个关键值的表再插值，
+// 动画中参数连续变化也只是偶尔烘焙一张新表，其余帧只做一次插值
+class RemapCache {
+public:
+    explicit RemapCache(size_t capacity = 8) : capacity(max((size_t)2, capacity)), clock(0) {
+    }
+
+    const RemapMap& Get(RemapEffect effect, float parameter, int w, int h, float step = 0.0f) {
+        if (step <= 0.0f) {
+            return Lookup(effect, parameter, w, h);
+        }
+        float index = floorf(parameter / step);
+        int t = (int)((parameter / step - index) * REMAP_BLEND_STEPS + 0.5f);
+        if (t == 0 || t == REMAP_BLEND_STEPS) {
+            return Lookup(effect, (index + (t ? 1.0f : 0.0f)) * step, w, h);
+        }
+        const RemapMap& a = Lookup(effect, index * step, w, h);
+        const RemapMap& b = Lookup(effect, (index + 1.0f) * step, w, h);
+        BlendRemap(a, b, t, blended);
+        return blended;
+    }
+    void Clear() {
+        entries.clear();
+        blended = RemapMap();
+    }
+
+private:
+    struct Key {
+        int effect;
+        int width;
+        int height;
+        float parameter;
+        bool operator<(const Key& other) const {
+            if (effect != other.effect) return effect < other.effect;
+            if (width != other.width) return width < other.width;
+            if (height != other.height) return height < other.height;
+            return parameter < other.parameter;
+        }
+    };
+    struct Entry {
+        RemapMap map;
+        ULONGLONG used;
+    };
+    size_t capacity;
+    ULONGLONG clock;
+    std::map<Key, Entry> entries;
+    RemapMap blended;
+
+    const RemapMap& Lookup(RemapEffect effect, float parameter, int w, int h) {
+        Key key = { (int)effect, w, h, parameter };
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            // 刚用过的表 used 最大，淘汰时不会被挑中，所以 Get 里先取的那张在取第二张时仍然有效
+            if (entries.size() >= capacity) {
+                auto oldest = entries.begin();
+                for (auto i = entries.begin(); i != entries.end(); ++i) {
+                    if (i->second.used < oldest->second.used) {
+                        oldest = i;
+                    }
+                }
+                entries.erase(oldest);
+            }
+            it = entries.insert(std::make_pair(key, Entry())).first;
+            BakeRemap(it->second.map, w, h, [effect, parameter, w, h](float x, float y, float& sx, float& sy) {
+                RemapCoordinate(effect, parameter, w, h, x, y, sx, sy);
+            });
+        }
+        it->second.used = ++clock;
+        return it->second.map;
+    }
+};
@@ -0,0 +1,123 @@
+﻿#pragma once
+#include <Windows.h>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 缩小一半：每 2x2 个像素取平均，宽高为奇数时最后一列 / 一行只和自己平均
+// target 的尺寸不是 ((w + 1) / 2) x ((h + 1) / 2) 时重新创建
+inline void Downsample2x(const Surface& source, Surface& target) {
+    if (source.Empty()) {
+        return;
+    }
+    int w = source.width;
+    int h = source.height;
+    int dw = (w + 1) / 2;
+    int dh = (h + 1) / 2;
+    if (target.width != dw || target.height != dh) {
+        target.Create(dw, dh);
+    }
+    ParallelFor(dh, [&source, &target, w, h, dw](int begin, int end) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+        for (int y = begin; y < end; y++) {
+            const _RGBQUAD* a = source.Row(y * 2);
+            const _RGBQUAD* b = source.Row(min(y * 2 + 1, h - 1));
+            PRGBQUAD dst = target.Row(y);
+            int x = 0;
+            // 每次读两行各 8 个像素，得到 4 个像素
+            for (; x * 2 + 8 <= w; x += 4) {
+                __m128i a0 = _mm_loadu_si128((const __m128i*)(a + x * 2));
+                __m128i a1 = _mm_loadu_si128((const __m128i*)(a + x * 2 + 4));
+                __m128i b0 = _mm_loadu_si128((const __m128i*)(b + x * 2));
+                __m128i b1 = _mm_loadu_si128((const __m128i*)(b + x * 2 + 4));
+                // 上下两行相加后，每个 64 位里是一个像素的 4 个通道，相邻两个像素再相加
+                __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+                __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+                __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+                __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+                __m128i hi = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+                _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(lo, hi));
+            }
+            for (; x < dw; x++) {
+                int x1 = min(x * 2 + 1, w - 1);
+                dst[x].b = (BYTE)((a[x * 2].b + a[x1].b + b[x * 2].b + b[x1].b + 2) >> 2);
+                dst[x].g = (BYTE)((a[x * 2].g + a[x1].g + b[x * 2].g + b[x1].g + 2) >> 2);
+                dst[x].r = (BYTE)((a[x * 2].r + a[x1].r + b[x * 2].r + b[x1].r + 2) >> 2);
+                dst[x].a = (BYTE)((a[x * 2].a + a[x1].a + b[x * 2].a + b[x1].a + 2) >> 2);
+            }
+        }
+    }, 16);
+}
+
+// 放大一倍（双线性，权重 3/4 和 1/4）后乘以 intensity 加到 target 上（逐通道饱和相加）
+// target 的尺寸应为 small 的两倍或两倍减一；intensity 不超过 16
+inline void UpsampleAdd(const Surface& small, Surface& target, float intensity = 1.0f) {
+    if (small.Empty() || target.Empty()) {
+        return;
+    }
+    int sw = small.width;
+    int sh = small.height;
+    int w = min(target.width, sw * 2);
+    // 放大后的值是原像素的 16 倍，乘以 weight / 65536 正好得到原像素乘以 intensity
+    WORD weight = (WORD)max(0.0f, min(65535.0f, intensity * 4096.0f + 0.5f));
+    ParallelFor(min(target.height, sh * 2), [&small, &target, sw, sh, w, weight](int begin, int end) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i factor = _mm_set1_epi16((short)weight);
+        // 竖直方向插值后的一行（每个像素 4 个 16 位通道，是原值的 4 倍），两端各补一个边缘像素
+        std::vector<short> line((size_t)(sw + 4) * 4, 0);
+        std::vector<_RGBQUAD> out((size_t)sw * 2 + 4);
+        for (int y = begin; y < end; y++) {
+            int sy = y / 2;
+            int ny = max(0, min(sh - 1, y & 1 ? sy + 1 : sy - 1));
+            const _RGBQUAD* near0 = small.Row(sy);
+            const _RGBQUAD* far0 = small.Row(ny);
+            short* v = &line[4];
+            int i = 0;
+            for (; i + 4 <= sw; i += 4) {
+                __m128i n = _mm_loadu_si128((const __m128i*)(near0 + i));
+                __m128i f = _mm_loadu_si128((const __m128i*)(far0 + i));
+                __m128i nLo = _mm_unpacklo_epi8(n, zero);
+                __m128i nHi = _mm_unpackhi_epi8(n, zero);
+                _mm_storeu_si128((__m128i*)(v + i * 4), _mm_add_epi16(_mm_add_epi16(nLo, _mm_slli_epi16(nLo, 1)), _mm_unpacklo_epi8(f, zero)));
+                _mm_storeu_si128((__m128i*)(v + i * 4 + 8), _mm_add_epi16(_mm_add_epi16(nHi, _mm_slli_epi16(nHi, 1)), _mm_unpackhi_epi8(f, zero)));
+            }
+            for (; i < sw; i++) {
+                v[i * 4] = (short)(near0[i].b * 3 + far0[i].b);
+                v[i * 4 + 1] = (short)(near0[i].g * 3 + far0[i].g);
+                v[i * 4 + 2] = (short)(near0[i].r * 3 + far0[i].r);
+                v[i * 4 + 3] = (short)(near0[i].a * 3 + far0[i].a);
+            }
+            for (int c = 0; c < 4; c++) {
+                v[c - 4] = v[c];
+                v[sw * 4 + c] = v[(sw - 1) * 4 + c];
+            }
+            // 水平方向：第 2i 个像素是 3v[i] + v[i-1]，第 2i+1 个是 3v[i] + v[i+1]，每次算 2 个原像素得到 4 个像素
+            for (i = 0; i < sw; i += 2) {
+                __m128i c = _mm_loadu_si128((const __m128i*)(v + i * 4));
+                __m128i l = _mm_loadu_si128((const __m128i*)(v + i * 4 - 4));
+                __m128i r = _mm_loadu_si128((const __m128i*)(v + i * 4 + 4));
+                __m128i c3 = _mm_add_epi16(c, _mm_slli_epi16(c, 1));
+                __m128i even = _mm_mulhi_epu16(_mm_add_epi16(c3, l), factor);
+                __m128i odd = _mm_mulhi_epu16(_mm_add_epi16(c3, r), factor);
+                _mm_storeu_si128((__m128i*)&out[i * 2], _mm_packus_epi16(_mm_unpacklo_epi64(even, odd), _mm_unpackhi_epi64(even, odd)));
+            }
+            PRGBQUAD dst = target.Row(y);
+            int x = 0;
+            for (; x + 4 <= w; x += 4) {
+                __m128i d = _mm_loadu_si128((const __m128i*)(dst + x));
+                _mm_storeu_si128((__m128i*)(dst + x), _mm_adds_epu8(d, _mm_loadu_si128((const __m128i*)&out[x])));
+            }
+            for (; x < w; x++) {
+                dst[x].b = (BYTE)min(255, dst[x].b + out[x].b);
+                dst[x].g = (BYTE)min(255, dst[x].g + out[x].g);
+                dst[x].r = (BYTE)min(255, dst[x].r + out[x].r);
+                dst[x].a = (BYTE)min(255, dst[x].a + out[x].a);
+            }
+        }
+    }, 16);
+}
@@ -0,0 +1,168 @@
+﻿#pragma once
+#include <Windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "surface.hpp"
+#include "text.hpp"
+
+// 环形滚动画布：逻辑坐标 (0, 0) 对应像素数组里的 (originX, originY)，超出右 / 下边缘的部分绕回左 / 上边
+// 滚动只移动原点，不搬动像素；只有新露出来的条带需要重新绘制，显示时按绕回位置分成最多四块拷贝
+class ScrollSurface {
+public:
+    Surface surface;    // 环形存放的像素
+    int originX;        // 逻辑 (0, 0) 在 surface 中的位置
+    int originY;
+    int scrollX;        // 逻辑 (0, 0) 对应的内容坐标（累计滚动量）
+    int scrollY;
+
+    ScrollSurface() : originX(0), originY(0), scrollX(0), scrollY(0) {
+    }
+    ScrollSurface(int width, int height) : ScrollSurface() {
+        Create(width, height);
+    }
+
+    void Create(int width, int height) {
+        surface.Create(width, height);
+        originX = originY = 0;
+        scrollX = scrollY = 0;
+    }
+    int Width() const {
+        return surface.width;
+    }
+    int Height() const {
+        return surface.height;
+    }
+
+    // 重画整个可见区域；render(strip, contentX, contentY) 画的是以内容坐标 (contentX, contentY) 为左上角的一块
+    template <typename RenderFunc>
+    void Redraw(RenderFunc render) {
+        Expose(0, 0, surface.width, surface.height, render);
+    }
+
+    // 视口在内容上移动 (dx, dy)：dx > 0 时内容向左移、右边露出新的一列条带，dy 同理
+    // 只有露出来的条带会交给 render 绘制，花费和滚动距离成正比
+    template <typename RenderFunc>
+    void Scroll(int dx, int dy, RenderFunc render) {
+        int w = surface.width;
+        int h = surface.height;
+        if (w <= 0 || h <= 0) {
+            return;
+        }
+        scrollX += dx;
+        scrollY += dy;
+        originX = Wrap(originX + dx, w);
+        originY = Wrap(originY + dy, h);
+        if (abs(dx) >= w || abs(dy) >= h) {
+            Expose(0, 0, w, h, render);
+            return;
+        }
+        // 先画水平方向露出的整列条带，再画竖直方向露出的行条带（去掉和列条带重叠的部分）
+        int columnX = dx > 0 ? w - dx : 0;
+        int columnW = abs(dx);
+        if (columnW > 0) {
+            Expose(columnX, 0, columnW, h, render);
+        }
+        if (dy != 0) {
+            int rowY = dy > 0 ? h - dy : 0;
+            int restX = dx > 0 ? 0 : columnW;
+            Expose(restX, rowY, w - columnW, abs(dy), render);
+        }
+    }
+
+    // 把可见区域拷到 hdc 的 (x, y)：按绕回位置分成最多四块 BitBlt，横向滚动时只有两块
+    void Present(HDC hdc, int x = 0, int y = 0) const {
+        int w = surface.width;
+        int h = surface.height;
+        int rightW = w - originX;
+        int bottomH = h - originY;
+        surface.Present(hdc, x, y, originX, originY, rightW, bottomH);
+        if (originX > 0) {
+            surface.Present(hdc, x + rightW, y, 0, originY, originX, bottomH);
+        }
+        if (originY > 0) {
+            surface.Present(hdc, x, y + bottomH, originX, 0, rightW, originY);
+        }
+        if (originX > 0 && originY > 0) {
+            surface.Present(hdc, x + rightW, y + bottomH, 0, 0, originX, originY);
+        }
+    }
+
+    // 逻辑坐标 (x, y) 所在的像素
+    PRGBQUAD Pixel(int x, int y) const {
+        return surface.Row(Wrap(y + originY, surface.height)) + Wrap(x + originX, surface.width);
+    }
+
+private:
+    std::vector<_RGBQUAD> strip;    // 绘制条带用的临时缓冲
+
+    static int Wrap(int v, int size) {
+        v %= size;
+        return v < 0 ? v + size : v;
+    }
+
+    // 在连续的临时缓冲里画好逻辑区域 [x, x + w) x [y, y + h)，再按行拷进环形画布（跨过边缘的行拆成两段）
+    template <typename RenderFunc>
+    void Expose(int x, int y, int w, int h, RenderFunc render) {
+        if (w <= 0 || h <= 0) {
+            return;
+        }
+        strip.resize((size_t)w * h);
+        Surface view(strip.data(), w, h);
+        render(view, scrollX + x, scrollY + y);
+        int px = Wrap(x + originX, surface.width);
+        int first = min(w, surface.width - px);
+        for (int row = 0; row < h; row++) {
+            PRGBQUAD dst = surface.Row(Wrap(y + row + originY, surface.height));
+            const _RGBQUAD* src = view.Row(row);
+            memcpy(dst + px, src, first * sizeof(_RGBQUAD));
+            if (first < w) {
+                memcpy(dst, src + first, (w - first) * sizeof(_RGBQUAD));
+            }
+        }
+    }
+};
+
+// 跑马灯：一行文本循环向左滚动，每一步只画新露出来的条带
+class Marquee {
+public:
+    ScrollSurface view;
+
+    // 文本用 glyphs 里的 font 绘制，背景为 background 颜色，相邻两遍文本之间空出 gap 像素
+    Marquee(GlyphCache& glyphs, int font, const std::wstring& text, int width, COLORREF color, COLORREF background, int gap = 64)
+        : glyphs(glyphs), font(font), text(text), color(color), background(ToPixel(background)) {
+        period = max(1, glyphs.Measure(font, text.c_str(), (int)text.size()) + gap);
+        view.Create(width, glyphs.LineHeight(font));
+        view.Redraw([this](Surface& strip, int contentX, int contentY) {
+            Render(strip, contentX);
+        });
+    }
+
+    // 向左滚动 pixels 像素
+    void Step(int pixels) {
+        view.Scroll(pixels, 0, [this](Surface& strip, int contentX, int contentY) {
+            Render(strip, contentX);
+        });
+    }
+    void Present(HDC hdc, int x, int y) const {
+        view.Present(hdc, x, y);
+    }
+
+private:
+    GlyphCache& glyphs;
+    int font;
+    std::wstring text;
+    COLORREF color;
+    DWORD background;
+    int period;     // 文本宽度加间隔，内容按这个周期重复
+
+    void Render(Surface& strip, int contentX) {
+        strip.Clear(background);
+        // 只画和条带相交的那几遍文本
+        int first = contentX - ((contentX % period) + period) % period;
+        for (int start = first; start < contentX + strip.width; start += period) {
+            glyphs.DrawString(strip, start - contentX, 0, font, text.c_str(), (int)text.size(), color);
+        }
+    }
+};
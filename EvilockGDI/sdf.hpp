@@ -0,0 +1,285 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <vector>
+#include <unordered_map>
+#include "surface.hpp"
+#include "parallel.hpp"
+#include "text.hpp"
+
+// 距离变换里表示“没有”的距离平方，比任何实际距离都大，-SDF_INFINITY 也比任何交点都小
+const float SDF_INFINITY = 1e20f;
+
+// 有向距离场：每个像素到形状边缘的距离，形状外为正，形状内为负
+// 用 Felzenszwalb 的精确欧氏距离变换生成：先逐列、再逐行做一维下包络，两遍都是线性时间并按列 / 行分给多个线程
+class DistanceField {
+public:
+    std::vector<float> data;
+    int width;
+    int height;
+
+    DistanceField() : width(0), height(0) {
+    }
+
+    // 从覆盖率蒙版（0～255，第 y 行从 mask + y * stride 开始）生成距离场，四周各留出 padding 像素给外发光等效果
+    void FromMask(const BYTE* mask, int w, int h, int stride, int padding = 0) {
+        width = w + padding * 2;
+        height = h + padding * 2;
+        std::vector<float> outside((size_t)width * height, SDF_INFINITY);   // 到最近的形状内像素的距离平方
+        std::vector<float> inside((size_t)width * height, 0.0f);   // 到最近的形状外像素的距离平方
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                if (mask[(size_t)y * stride + x] >= 128) {
+                    size_t i = (size_t)(y + padding) * width + x + padding;
+                    outside[i] = 0.0f;
+                    inside[i] = SDF_INFINITY;
+                }
+            }
+        }
+        Transform(outside);
+        Transform(inside);
+        data.resize((size_t)width * height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                size_t i = (size_t)y * width + x;
+                float d = outside[i] > 0.0f ? sqrtf(outside[i]) - 0.5f : 0.5f - sqrtf(inside[i]);
+                // 抗锯齿边缘上的像素直接用覆盖率估计到边缘的距离
+                int sx = x - padding;
+                int sy = y - padding;
+                if (sx >= 0 && sy >= 0 && sx < w && sy < h) {
+                    BYTE m = mask[(size_t)sy * stride + sx];
+                    if (m > 0 && m < 255) {
+                        d = 0.5f - m / 255.0f;
+                    }
+                }
+                data[i] = d;
+            }
+        }
+    }
+    // 用表面的 alpha 通道作为蒙版
+    void FromAlpha(const Surface& source, int padding = 0) {
+        std::vector<BYTE> mask((size_t)source.width * source.height);
+        for (int y = 0; y < source.height; y++) {
+            const _RGBQUAD* row = source.Row(y);
+            for (int x = 0; x < source.width; x++) {
+                mask[(size_t)y * source.width + x] = row[x].a;
+            }
+        }
+        FromMask(mask.data(), source.width, source.height, source.width, padding);
+    }
+
+    // 双线性采样，坐标超出范围时取边缘的值
+    float Sample(float x, float y) const {
+        x = max(0.0f, min(x, width - 1.0f));
+        y = max(0.0f, min(y, height - 1.0f));
+        int x0 = min((int)x, width - 2 < 0 ? 0 : width - 2);
+        int y0 = min((int)y, height - 2 < 0 ? 0 : height - 2);
+        int x1 = min(x0 + 1, width - 1);
+        int y1 = min(y0 + 1, height - 1);
+        float fx = x - x0;
+        float fy = y - y0;
+        const float* r0 = &data[(size_t)y0 * width];
+        const float* r1 = &data[(size_t)y1 * width];
+        float top = r0[x0] + (r0[x1] - r0[x0]) * fx;
+        float bottom = r1[x0] + (r1[x1] - r1[x0]) * fx;
+        return top + (bottom - top) * fy;
+    }
+
+private:
+    // 抛物线 q 和 p 的交点
+    static float Intersect(const float* f, int q, int p) {
+        return ((f[q] + (float)q * q) - (f[p] + (float)p * p)) / (2.0f * (q - p));
+    }
+
+    // 一维距离变换：d[q] = min over p (f[p] + (q - p)^2)，v / z 记录下包络的抛物线和分界点
+    static void Transform1D(const float* f, int n, float* d, int* v, float* z) {
+        int k = 0;
+        v[0] = 0;
+        z[0] = -SDF_INFINITY;
+        z[1] = SDF_INFINITY;
+        for (int q = 1; q < n; q++) {
+            float s = Intersect(f, q, v[k]);
+            while (s <= z[k]) {
+                k--;
+                s = Intersect(f, q, v[k]);
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = SDF_INFINITY;
+        }
+        k = 0;
+        for (int q = 0; q < n; q++) {
+            while (z[k + 1] < q) {
+                k++;
+            }
+            float dq = (float)(q - v[k]);
+            d[q] = dq * dq + f[v[k]];
+        }
+    }
+
+    // 二维距离变换：先处理每一列，再处理每一行
+    void Transform(std::vector<float>& grid) const {
+        int w = width;
+        int h = height;
+        float* cells = grid.data();
+        ParallelForRows(w, h, [cells, w, h](int begin, int end) {
+            std::vector<float> f(h), d(h), z(h + 1);
+            std::vector<int> v(h);
+            for (int x = begin; x < end; x++) {
+                for (int y = 0; y < h; y++) {
+                    f[y] = cells[(size_t)y * w + x];
+                }
+                Transform1D(f.data(), h, d.data(), v.data(), z.data());
+                for (int y = 0; y < h; y++) {
+                    cells[(size_t)y * w + x] = d[y];
+                }
+            }
+        });
+        ParallelForRows(h, w, [cells, w](int begin, int end) {
+            std::vector<float> f(w), z(w + 1);
+            std::vector<int> v(w);
+            for (int y = begin; y < end; y++) {
+                float* row = cells + (size_t)y * w;
+                memcpy(f.data(), row, w * sizeof(float));
+                Transform1D(f.data(), w, row, v.data(), z.data());
+            }
+        });
+    }
+};
+
+// 按距离决定覆盖率的几种效果，参数 d 是换算到目标像素后的有向距离
+struct SdfFill {
+    float operator()(float d) const {
+        return max(0.0f, min(1.0f, 0.5f - d));
+    }
+};
+// 形状外侧宽 width 的描边
+struct SdfOutline {
+    float width;
+    SdfOutline(float width) : width(width) {
+    }
+    float operator()(float d) const {
+        return max(0.0f, min(1.0f, min(d + 0.5f, width + 0.5f - d)));
+    }
+};
+// 从边缘向外 radius 像素内逐渐消失的外发光
+struct SdfGlow {
+    float radius;
+    SdfGlow(float radius) : radius(max(1.0f, radius)) {
+    }
+    float operator()(float d) const {
+        if (d <= 0.0f) {
+            return 1.0f;
+        }
+        float t = max(0.0f, 1.0f - d / radius);
+        return t * t;
+    }
+};
+// 边缘模糊 softness 像素的阴影（配合偏移的位置使用）
+struct SdfShadow {
+    float softness;
+    SdfShadow(float softness) : softness(max(1.0f, softness)) {
+    }
+    float operator()(float d) const {
+        return max(0.0f, min(1.0f, 0.5f - d / softness));
+    }
+};
+
+// 把距离场按 scale 倍缩放后画到 target 的 (x, y)，每个像素的覆盖率由 coverage(距离) 给出，颜色为预乘的 pixel
+template <typename CoverageFunc>
+inline void RenderDistanceField(Surface& target, float x, float y, const DistanceField& field, float scale, DWORD pixel, CoverageFunc coverage) {
+    if (field.width == 0 || scale <= 0.0f) {
+        return;
+    }
+    int x0 = max(0, (int)floorf(x));
+    int y0 = max(0, (int)floorf(y));
+    int x1 = min(target.width, (int)ceilf(x + field.width * scale));
+    int y1 = min(target.height, (int)ceilf(y + field.height * scale));
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    float inverse = 1.0f / scale;
+    // 一个字形通常只有几千个像素，按面积决定是否并行，逐字绘制时不会每个字都唤醒一遍线程
+    ParallelForRows(y1 - y0, x1 - x0, [&](int begin, int end) {
+        std::vector<BYTE> mask(x1 - x0);
+        for (int row = y0 + begin; row < y0 + end; row++) {
+            float fy = (row + 0.5f - y) * inverse - 0.5f;
+            for (int col = x0; col < x1; col++) {
+                float fx = (col + 0.5f - x) * inverse - 0.5f;
+                mask[col - x0] = (BYTE)(coverage(field.Sample(fx, fy) * scale) * 255.0f + 0.5f);
+            }
+            BlendMaskSpan(target.Row(row) + x0, pixel, mask.data(), x1 - x0);
+        }
+    });
+}
+
+// 距离场文字：每个字形从字形图集生成一次距离场，之后按任意倍数缩放绘制都不用重新光栅化
+class SdfText {
+public:
+    // padding 是字形四周留出的距离场范围，决定了描边 / 发光最多能画多宽（按基准字号计）
+    SdfText(GlyphCache& glyphs, int font, int padding = 8) : glyphs(glyphs), font(font), padding(padding) {
+    }
+
+    int LineHeight(float scale) const {
+        return (int)ceilf(glyphs.LineHeight(font) * scale);
+    }
+    float Measure(const wchar_t* text, int length, float scale) {
+        float width = 0.0f;
+        for (int i = 0; i < length; i++) {
+            width += GetEntry(text[i]).advance * scale;
+        }
+        return width;
+    }
+
+    // 以 (x, y) 为行的左上角，按 scale 倍画出文本；coverage 决定画的是字形本身、描边、发光还是阴影
+    template <typename CoverageFunc>
+    void DrawString(Surface& target, float x, float y, const wchar_t* text, int length, float scale, COLORREF color, BYTE alpha, CoverageFunc coverage) {
+        DWORD pixel = ToPixel(color, alpha);
+        float penX = x;
+        for (int i = 0; i < length; i++) {
+            if (text[i] == L'\n') {
+                penX = x;
+                y += glyphs.LineHeight(font) * scale;
+                continue;
+            }
+            const Entry& entry = GetEntry(text[i]);
+            if (entry.field.width > 0) {
+                RenderDistanceField(target, penX + entry.offsetX * scale, y + entry.offsetY * scale, entry.field, scale, pixel, coverage);
+            }
+            penX += entry.advance * scale;
+        }
+    }
+    void DrawString(Surface& target, float x, float y, const wchar_t* text, int length, float scale, COLORREF color, BYTE alpha = 255) {
+        DrawString(target, x, y, text, length, scale, color, alpha, SdfFill());
+    }
+
+private:
+    struct Entry {
+        DistanceField field;
+        int offsetX;    // 距离场左上角相对于笔位置的偏移（基准字号）
+        int offsetY;
+        int advance;
+    };
+
+    GlyphCache& glyphs;
+    int font;
+    int padding;
+    std::unordered_map<wchar_t, Entry> entries;
+
+    const Entry& GetEntry(wchar_t ch) {
+        std::unordered_map<wchar_t, Entry>::iterator it = entries.find(ch);
+        if (it != entries.end()) {
+            return it->second;
+        }
+        const GlyphCache::Glyph& glyph = glyphs.GetGlyph(font, ch);
+        Entry& entry = entries[ch];
+        entry.offsetX = glyph.offsetX - padding;
+        entry.offsetY = glyph.offsetY - padding;
+        entry.advance = glyph.advance;
+        if (glyph.width > 0 && glyph.height > 0) {
+            entry.field.FromMask(glyphs.AtlasRow(glyph, 0), glyph.width, glyph.height, glyphs.AtlasStride(), padding);
+        }
+        return entry;
+    }
+};
@@ -0,0 +1,328 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "surface.hpp"
+#pragma comment(lib, "msimg32.lib")
+
+// 把图标按指定大小画成预乘 alpha 的精灵
+// 分别画在黑底和白底上，两次结果的差就是透明度，黑底上的结果就是预乘后的颜色
+inline bool RenderIconSprite(HICON icon, int width, int height, Surface& out) {
+    Surface white(width, height);
+    out.Create(width, height);
+    if (out.Empty() || white.Empty()) {
+        return false;
+    }
+    out.Clear(0xFF000000);
+    white.Clear(0xFFFFFFFF);
+    if (!DrawIconEx(out.hdcMem, 0, 0, icon, width, height, 0, NULL, DI_NORMAL) ||
+        !DrawIconEx(white.hdcMem, 0, 0, icon, width, height, 0, NULL, DI_NORMAL)) {
+        return false;
+    }
+    GdiFlush();
+
+    size_t count = (size_t)width * height;
+    for (size_t i = 0; i < count; i++) {
+        _RGBQUAD& black = out.pixels[i];
+        const _RGBQUAD& onWhite = white.pixels[i];
+        int diff = max(max(onWhite.r - black.r, onWhite.g - black.g), onWhite.b - black.b);
+        BYTE alpha = (BYTE)(255 - max(0, min(255, diff)));
+        black.r = min(black.r, alpha);
+        black.g = min(black.g, alpha);
+        black.b = min(black.b, alpha);
+        black.a = alpha;
+    }
+    return true;
+}
+
+// 在预乘精灵上做双线性采样，坐标以像素中心为 (i + 0.5)，超出范围的部分视为透明
+inline void SampleBilinear(const Surface& src, float x, float y, float* acc) {
+    x -= 0.5f;
+    y -= 0.5f;
+    int x0 = (int)floorf(x);
+    int y0 = (int)floorf(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    float weights[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+    for (int k = 0; k < 4; k++) {
+        int sx = x0 + (k & 1);
+        int sy = y0 + (k >> 1);
+        if (sx < 0 || sy < 0 || sx >= src.width || sy >= src.height) {
+            continue;
+        }
+        const _RGBQUAD& p = src.Row(sy)[sx];
+        acc[0] += p.b * weights[k];
+        acc[1] += p.g * weights[k];
+        acc[2] += p.r * weights[k];
+        acc[3] += p.a * weights[k];
+    }
+}
+
+// 把 2 倍分辨率的精灵旋转 angle（弧度）并缩小到 width x height，每个输出像素取 2x2 个子样本
+// 输出表面会扩大到能放下旋转后的整个图标，(offsetX, offsetY) 是它相对于未旋转图标左上角的偏移
+inline void RotateSprite(const Surface& hiRes, int width, int height, float angle, Surface& out, int& offsetX, int& offsetY) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    int outWidth = (int)ceilf(fabsf(width * c) + fabsf(height * s) - 0.001f);
+    int outHeight = (int)ceilf(fabsf(width * s) + fabsf(height * c) - 0.001f);
+    offsetX = (width - outWidth) / 2;
+    offsetY = (height - outHeight) / 2;
+    out.Create(outWidth, outHeight);
+    if (out.Empty()) {
+        return;
+    }
+
+    const float subOffset[2] = { -0.25f, 0.25f };
+    float halfW = outWidth * 0.5f;
+    float halfH = outHeight * 0.5f;
+    for (int oy = 0; oy < outHeight; oy++) {
+        PRGBQUAD row = out.Row(oy);
+        for (int ox = 0; ox < outWidth; ox++) {
+            float acc[4] = { 0, 0, 0, 0 };
+            for (int k = 0; k < 4; k++) {
+                // 反向旋转回未旋转图标的坐标系，再映射到 2 倍分辨率的源图
+                float dx = ox + 0.5f + subOffset[k & 1] - halfW;
+                float dy = oy + 0.5f + subOffset[k >> 1] - halfH;
+                float ux = dx * c + dy * s + width * 0.5f;
+                float uy = -dx * s + dy * c + height * 0.5f;
+                SampleBilinear(hiRes, ux * 2.0f, uy * 2.0f, acc);
+            }
+            row[ox].b = (BYTE)(acc[0] * 0.25f + 0.5f);
+            row[ox].g = (BYTE)(acc[1] * 0.25f + 0.5f);
+            row[ox].r = (BYTE)(acc[2] * 0.25f + 0.5f);
+            row[ox].a = (BYTE)(acc[3] * 0.25f + 0.5f);
+        }
+    }
+}
+
+// 按行游程编码的精灵：每行拆成透明 / 不透明 / 半透明三种游程
+// 绘制时透明游程直接跳过，不透明游程整段 memcpy，只有半透明游程才需要混合
+class RleSprite {
+public:
+    enum RunType { RUN_TRANSPARENT = 0, RUN_OPAQUE = 1, RUN_TRANSLUCENT = 2 };
+    struct Run {
+        WORD type;
+        WORD length;
+    };
+
+    int width;
+    int height;
+
+    RleSprite() : width(0), height(0) {
+    }
+    explicit RleSprite(const Surface& sprite) : width(0), height(0) {
+        Build(sprite);
+    }
+
+    void Build(const Surface& sprite) {
+        width = sprite.width;
+        height = sprite.height;
+        runs.clear();
+        data.clear();
+        rowRun.assign(height + 1, 0);
+        rowData.assign(height + 1, 0);
+        for (int y = 0; y < height; y++) {
+            rowRun[y] = runs.size();
+            rowData[y] = data.size();
+            const _RGBQUAD* row = sprite.Row(y);
+            int x = 0;
+            while (x < width) {
+                WORD type = Classify(row[x]);
+                int start = x;
+                while (x < width && x - start < 0xFFFF && Classify(row[x]) == type) {
+                    x++;
+                }
+                Run run = { type, (WORD)(x - start) };
+                runs.push_back(run);
+                if (type != RUN_TRANSPARENT) {
+                    data.insert(data.end(), row + start, row + x);
+                }
+            }
+        }
+        rowRun[height] = runs.size();
+        rowData[height] = data.size();
+    }
+    bool Empty() const {
+        return width == 0 || height == 0;
+    }
+    size_t Bytes() const {
+        return runs.size() * sizeof(Run) + data.size() * sizeof(_RGBQUAD) + (rowRun.size() + rowData.size()) * sizeof(size_t);
+    }
+
+    // 把精灵画到表面的 (x, y) 处，超出表面的部分会被裁掉
+    void Blit(Surface& dst, int x, int y) const {
+        int yStart = max(0, -y);
+        int yEnd = min(height, dst.height - y);
+        int clipLeft = -x;
+        int clipRight = dst.width - x;
+        if (clipLeft >= width || clipRight <= 0) {
+            return;
+        }
+        for (int row = yStart; row < yEnd; row++) {
+            PRGBQUAD out = dst.Row(y + row) + x;
+            const _RGBQUAD* pixels = data.data() + rowData[row];
+            int pos = 0;
+            for (size_t r = rowRun[row]; r < rowRun[row + 1] && pos < clipRight; r++) {
+                const Run& run = runs[r];
+                int start = max(pos, clipLeft);
+                int end = min(pos + (int)run.length, clipRight);
+                if (run.type != RUN_TRANSPARENT) {
+                    if (start < end) {
+                        const _RGBQUAD* src = pixels + (start - pos);
+                        if (run.type == RUN_OPAQUE) {
+                            memcpy(out + start, src, (end - start) * sizeof(_RGBQUAD));
+                        }
+                        else {
+                            BlendSpan(out + start, src, end - start);
+                        }
+                    }
+                    pixels += run.length;
+                }
+                pos += run.length;
+            }
+        }
+    }
+
+private:
+    std::vector<Run> runs;
+    std::vector<_RGBQUAD> data;     // 不透明和半透明游程的像素，按顺序连续存放
+    std::vector<size_t> rowRun;     // 每行第一个游程的下标
+    std::vector<size_t> rowData;    // 每行第一个像素在 data 中的下标
+
+    static WORD Classify(const _RGBQUAD& p) {
+        if (p.a == 0) {
+            return RUN_TRANSPARENT;
+        }
+        return p.a == 255 ? RUN_OPAQUE : RUN_TRANSLUCENT;
+    }
+};
+
+// 图标旋转/缩放变体缓存：角度和尺寸量化成桶，每个变体只高质量渲染一次，超出内存预算时按 LRU 淘汰
+class SpriteCache {
+public:
+    struct Sprite {
+        Surface image;   // 预乘 alpha 的图像
+        RleSprite rle;   // 同一图像的游程编码，用于快速绘制
+        int offsetX;     // 相对于未旋转图标左上角的偏移
+        int offsetY;
+    };
+
+    SpriteCache(size_t budgetBytes = 64 * 1024 * 1024, int angleSteps = 64, int sizeStepsPerOctave = 8)
+        : budget(budgetBytes), used(0), angleSteps(max(1, angleSteps)), sizeSteps(max(1, sizeStepsPerOctave)) {
+    }
+    SpriteCache(const SpriteCache&) = delete;
+    SpriteCache& operator=(const SpriteCache&) = delete;
+
+    // 取得最接近 (width, height, angle) 的变体，失败返回 NULL
+    const Sprite* Get(HICON icon, int width, int height, float angle) {
+        if (icon == NULL || width <= 0 || height <= 0) {
+            return NULL;
+        }
+        Key key = { icon, SizeBucket(width), SizeBucket(height), AngleBucket(angle) };
+        auto found = index.find(key);
+        if (found != index.end()) {
+            lru.splice(lru.begin(), lru, found->second);
+            return &found->second->sprite;
+        }
+
+        lru.emplace_front();
+        Entry& entry = lru.front();
+        entry.key = key;
+        if (!Render(key, entry.sprite)) {
+            lru.pop_front();
+            return NULL;
+        }
+        index[key] = lru.begin();
+        used += entry.sprite.image.Bytes() + entry.sprite.rle.Bytes();
+        Evict();
+        return &lru.front().sprite;
+    }
+    void SetBudget(size_t budgetBytes) {
+        budget = budgetBytes;
+        Evict();
+    }
+    size_t MemoryUsed() const {
+        return used;
+    }
+    void Clear() {
+        index.clear();
+        lru.clear();
+        used = 0;
+    }
+
+private:
+    struct Key {
+        HICON icon;
+        int width;
+        int height;
+        int angle;
+        bool operator==(const Key& other) const {
+            return icon == other.icon && width == other.width && height == other.height && angle == other.angle;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t h = std::hash<void*>()((void*)key.icon);
+            h ^= ((size_t)key.width * 73856093u) ^ ((size_t)key.height * 19349663u) ^ ((size_t)key.angle * 83492791u);
+            return h;
+        }
+    };
+    struct Entry {
+        Key key;
+        Sprite sprite;
+    };
+
+    size_t budget;
+    size_t used;
+    int angleSteps;
+    int sizeSteps;
+    std::list<Entry> lru;  // 越靠前越是最近使用
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    // 尺寸按对数量化：每翻一倍分成 sizeSteps 个桶
+    int SizeBucket(int size) const {
+        return (int)lround(log2((double)size) * sizeSteps);
+    }
+    int BucketSize(int bucket) const {
+        return max(1, (int)lround(exp2((double)bucket / sizeSteps)));
+    }
+    int AngleBucket(float angle) const {
+        double turns = angle / (2 * PI);
+        int bucket = (int)lround((turns - floor(turns)) * angleSteps);
+        return bucket % angleSteps;
+    }
+    bool Render(const Key& key, Sprite& sprite) const {
+        int width = BucketSize(key.width);
+        int height = BucketSize(key.height);
+        Surface hiRes;
+        if (!RenderIconSprite(key.icon, width * 2, height * 2, hiRes)) {
+            return false;
+        }
+        float angle = (float)(key.angle * 2 * PI / angleSteps);
+        RotateSprite(hiRes, width, height, angle, sprite.image, sprite.offsetX, sprite.offsetY);
+        if (sprite.image.Empty()) {
+            return false;
+        }
+        // 进入缓存时顺便生成游程编码
+        sprite.rle.Build(sprite.image);
+        return true;
+    }
+    void Evict() {
+        // 至少保留刚放进来的那个变体
+        while (used > budget && lru.size() > 1) {
+            Entry& last = lru.back();
+            used -= last.sprite.image.Bytes() + last.sprite.rle.Bytes();
+            index.erase(last.key);
+            lru.pop_back();
+        }
+    }
+};
+
+// 用 AlphaBlend 把预乘精灵画到设备上下文，(x, y) 是未旋转图标的左上角
+inline void DrawSprite(HDC hdc, int x, int y, const SpriteCache::Sprite& sprite) {
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    AlphaBlend(hdc, x + sprite.offsetX, y + sprite.offsetY, sprite.image.width, sprite.image.height,
+        sprite.image.hdcMem, 0, 0, sprite.image.width, sprite.image.height, blend);
+}
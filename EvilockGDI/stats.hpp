@@ -0,0 +1,192 @@
+﻿#pragma once
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 一帧画面的统计结果，通道顺序为 b、g、r、a（和像素里的字节顺序一致）
+struct SurfaceStats {
+    DWORD histogram[4][256];    // 每个通道的直方图
+    DWORD luma[256];            // 亮度 (29b + 150g + 77r) >> 8 的直方图
+    BYTE minimum[4];
+    BYTE maximum[4];
+    ULONGLONG sum[4];
+    ULONGLONG count;            // 参与统计的像素数
+
+    SurfaceStats() {
+        Reset();
+    }
+    void Reset() {
+        memset(histogram, 0, sizeof(histogram));
+        memset(luma, 0, sizeof(luma));
+        memset(sum, 0, sizeof(sum));
+        memset(minimum, 255, sizeof(minimum));
+        memset(maximum, 0, sizeof(maximum));
+        count = 0;
+    }
+    // 把另一部分的统计结果合并进来
+    void Merge(const SurfaceStats& other) {
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < 256; i++) {
+                histogram[c][i] += other.histogram[c][i];
+            }
+            minimum[c] = min(minimum[c], other.minimum[c]);
+            maximum[c] = max(maximum[c], other.maximum[c]);
+            sum[c] += other.sum[c];
+        }
+        for (int i = 0; i < 256; i++) {
+            luma[i] += other.luma[i];
+        }
+        count += other.count;
+    }
+
+    // 第 c 个通道的平均值
+    float Average(int c) const {
+        return count > 0 ? (float)((double)sum[c] / count) : 0.0f;
+    }
+    COLORREF AverageColor() const {
+        return RGB((BYTE)(Average(2) + 0.5f), (BYTE)(Average(1) + 0.5f), (BYTE)(Average(0) + 0.5f));
+    }
+    // 直方图 hist 中至少有 fraction（0～1）的像素不超过返回值（fraction 为 0 / 1 时就是最小 / 最大值）
+    BYTE Percentile(const DWORD* hist, float fraction) const {
+        ULONGLONG target = max((ULONGLONG)1, (ULONGLONG)ceil((double)fraction * count));
+        ULONGLONG total = 0;
+        for (int i = 0; i < 256; i++) {
+            total += hist[i];
+            if (total >= target) {
+                return (BYTE)i;
+            }
+        }
+        return 255;
+    }
+};
+
+// 统计表面上的像素：行分给多个线程，每个线程先在自己的直方图里计数，最后合并，线程之间不共享计数器
+// step 大于 1 时只统计每隔 step 行、每隔 step 列的像素（抽样），花费约为完整统计的 1 / step^2，适合每帧粗略估计
+inline void AnalyzeSurface(const Surface& surface, SurfaceStats& stats, int step = 1) {
+    stats.Reset();
+    if (surface.Empty()) {
+        return;
+    }
+    step = max(1, step);
+    std::mutex lock;
+    int rows = (surface.height + step - 1) / step;
+    ParallelFor(rows, [&surface, &stats, &lock, step](int begin, int end) {
+        SurfaceStats local;
+        const __m128i zero = _mm_setzero_si128();
+        __m128i low = _mm_set1_epi8((char)0xFF);
+        __m128i high = zero;
+        __m128i sums[4] = { zero, zero, zero, zero };
+        for (int r = begin; r < end; r++) {
+            const _RGBQUAD* row = surface.Row(r * step);
+            int x = 0;
+            if (step == 1) {
+                // 连续的像素用 SIMD 求最值和通道和：把其他通道遮掉后 psadbw 对 0 求差，就是这个通道的字节和
+                for (; x + 4 <= surface.width; x += 4) {
+                    __m128i p = _mm_loadu_si128((const __m128i*)(row + x));
+                    low = _mm_min_epu8(low, p);
+                    high = _mm_max_epu8(high, p);
+                    for (int c = 0; c < 4; c++) {
+                        __m128i channel = _mm_and_si128(p, _mm_set1_epi32((int)(0xFFu << (c * 8))));
+                        sums[c] = _mm_add_epi64(sums[c], _mm_sad_epu8(channel, zero));
+                    }
+                    for (int i = 0; i < 4; i++) {
+                        const _RGBQUAD& q = row[x + i];
+                        local.histogram[0][q.b]++;
+                        local.histogram[1][q.g]++;
+                        local.histogram[2][q.r]++;
+                        local.histogram[3][q.a]++;
+                        local.luma[(q.b * 29 + q.g * 150 + q.r * 77 + 128) >> 8]++;
+                    }
+                }
+                local.count += x;
+            }
+            for (; x < surface.width; x += step) {
+                const _RGBQUAD& q = row[x];
+                const BYTE* channels = (const BYTE*)&q;
+                for (int c = 0; c < 4; c++) {
+                    local.histogram[c][channels[c]]++;
+                    local.minimum[c] = min(local.minimum[c], channels[c]);
+                    local.maximum[c] = max(local.maximum[c], channels[c]);
+                    local.sum[c] += channels[c];
+                }
+                local.luma[(q.b * 29 + q.g * 150 + q.r * 77 + 128) >> 8]++;
+                local.count++;
+            }
+        }
+        // 把 SIMD 累加器里 4 个像素位置的结果归并到各通道
+        BYTE lows[16], highs[16];
+        _mm_storeu_si128((__m128i*)lows, low);
+        _mm_storeu_si128((__m128i*)highs, high);
+        for (int i = 0; i < 16; i++) {
+            local.minimum[i & 3] = min(local.minimum[i & 3], lows[i]);
+            local.maximum[i & 3] = max(local.maximum[i & 3], highs[i]);
+        }
+        for (int c = 0; c < 4; c++) {
+            ULONGLONG halves[2];
+            _mm_storeu_si128((__m128i*)halves, sums[c]);
+            local.sum[c] += halves[0] + halves[1];
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        stats.Merge(local);
+    }, 16);
+}
+
+// 按查找表改写每个像素的 b、g、r 三个通道（alpha 不变），tables[c] 是第 c 个通道的表
+inline void ApplyChannelTables(Surface& surface, const BYTE tables[3][256]) {
+    ForEachPixel(surface, [tables](_RGBQUAD& pixel) {
+        pixel.b = tables[0][pixel.b];
+        pixel.g = tables[1][pixel.g];
+        pixel.r = tables[2][pixel.r];
+    });
+}
+
+// 自动色阶：每个通道两端各去掉 clip 比例的像素，把剩下的范围拉伸到 0～255
+// step 大于 1 时只抽样统计（见 AnalyzeSurface），拉伸仍然作用于全部像素
+inline void AutoLevels(Surface& surface, float clip = 0.005f, int step = 1) {
+    SurfaceStats stats;
+    AnalyzeSurface(surface, stats, step);
+    if (stats.count == 0) {
+        return;
+    }
+    BYTE tables[3][256];
+    for (int c = 0; c < 3; c++) {
+        int low = stats.Percentile(stats.histogram[c], clip);
+        int high = stats.Percentile(stats.histogram[c], 1.0f - clip);
+        for (int i = 0; i < 256; i++) {
+            if (high <= low) {
+                tables[c][i] = (BYTE)i;
+            }
+            else {
+                tables[c][i] = (BYTE)max(0, min(255, ((i - low) * 255 + (high - low) / 2) / (high - low)));
+            }
+        }
+    }
+    ApplyChannelTables(surface, tables);
+}
+
+// 直方图均衡化：按亮度的累积分布生成一张表，三个通道都用它重新映射，亮度分布变得均匀而色相大致不变
+inline void EqualizeHistogram(Surface& surface, int step = 1) {
+    SurfaceStats stats;
+    AnalyzeSurface(surface, stats, step);
+    if (stats.count == 0) {
+        return;
+    }
+    // 第一个非空的亮度值映射到 0，其余按累积比例拉开
+    ULONGLONG first = 0;
+    for (int i = 0; i < 256 && first == 0; i++) {
+        first = stats.luma[i];
+    }
+    BYTE tables[3][256];
+    ULONGLONG total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += stats.luma[i];
+        BYTE value = stats.count > first ? (BYTE)((total - min(total, first)) * 255 / (stats.count - first)) : (BYTE)i;
+        tables[0][i] = tables[1][i] = tables[2][i] = value;
+    }
+    ApplyChannelTables(surface, tables);
+}
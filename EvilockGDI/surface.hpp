@@ -0,0 +1,376 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+#include <emmintrin.h>
+#include "color.h"
+#include "parallel.hpp"
+// 把 COLORREF 转成表面使用的预乘 BGRA 像素值（0xAARRGGBB）
+inline DWORD ToPixel(COLORREF color, BYTE alpha = 255) {
+    DWORD r = GetRValue(color) * alpha / 255;
+    DWORD g = GetGValue(color) * alpha / 255;
+    DWORD b = GetBValue(color) * alpha / 255;
+    return ((DWORD)alpha << 24) | (r << 16) | (g << 8) | b;
+}
+// 除以 255（四舍五入），x 不超过 255 * 255
+inline DWORD Div255(DWORD x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+// 8 个 16 位通道分别除以 255（四舍五入）
+inline __m128i Div255Epi16(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// 预乘 alpha 的 source-over 混合：dst = src + dst * (255 - src.a) / 255
+inline void BlendSpan(PRGBQUAD dst, const _RGBQUAD* src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero);
+        __m128i sHi = _mm_unpackhi_epi8(s, zero);
+        // 把每个像素的 alpha 复制到它的 4 个通道上
+        __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i dLo = Div255Epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, aLo)));
+        __m128i dHi = Div255Epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, aHi)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(dLo, dHi)));
+    }
+    for (; i < count; i++) {
+        DWORD inv = 255 - src[i].a;
+        dst[i].b = (BYTE)min(255u, src[i].b + Div255(dst[i].b * inv));
+        dst[i].g = (BYTE)min(255u, src[i].g + Div255(dst[i].g * inv));
+        dst[i].r = (BYTE)min(255u, src[i].r + Div255(dst[i].r * inv));
+        dst[i].a = (BYTE)min(255u, src[i].a + Div255(dst[i].a * inv));
+    }
+}
+
+// 带覆盖率的 source-over 混合：源像素先乘以 mask / 255 再混合
+inline void BlendSpan(PRGBQUAD dst, const _RGBQUAD* src, const BYTE* mask, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        DWORD m4;
+        memcpy(&m4, mask + i, 4);
+        if (m4 == 0) {
+            continue;
+        }
+        __m128i m = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)m4), zero);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i sLo = Div255Epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi32(m, m)));
+        __m128i sHi = Div255Epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi32(m, m)));
+        __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i dLo = _mm_add_epi16(sLo, Div255Epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, aLo))));
+        __m128i dHi = _mm_add_epi16(sHi, Div255Epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, aHi))));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(dLo, dHi));
+    }
+    for (; i < count; i++) {
+        DWORD m = mask[i];
+        if (m == 0) {
+            continue;
+        }
+        DWORD sa = Div255(src[i].a * m);
+        DWORD inv = 255 - sa;
+        dst[i].b = (BYTE)min(255u, Div255(src[i].b * m) + Div255(dst[i].b * inv));
+        dst[i].g = (BYTE)min(255u, Div255(src[i].g * m) + Div255(dst[i].g * inv));
+        dst[i].r = (BYTE)min(255u, Div255(src[i].r * m) + Div255(dst[i].r * inv));
+        dst[i].a = (BYTE)min(255u, sa + Div255(dst[i].a * inv));
+    }
+}
+
+// 按覆盖率 mask（0～255）把一个预乘颜色混合到一段像素上：dst = c * m + dst * (1 - c.a * m)
+inline void BlendMaskSpan(PRGBQUAD dst, DWORD pixel, const BYTE* mask, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i color = _mm_unpacklo_epi8(_mm_set1_epi32((int)pixel), zero);
+    const __m128i alpha = _mm_set1_epi16((short)(pixel >> 24));
+    const DWORD alphaByte = pixel >> 24;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        DWORD m4;
+        memcpy(&m4, mask + i, 4);
+        if (m4 == 0) {
+            continue;
+        }
+        if (m4 == 0xFFFFFFFF && alphaByte == 255) {
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_set1_epi32((int)pixel));
+            continue;
+        }
+        // 每个像素的覆盖率复制到它的 4 个通道上
+        __m128i m = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)m4), zero);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i mLo = _mm_unpacklo_epi32(m, m);
+        __m128i mHi = _mm_unpackhi_epi32(m, m);
+        __m128i d = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i sLo = Div255Epi16(_mm_mullo_epi16(color, mLo));
+        __m128i sHi = Div255Epi16(_mm_mullo_epi16(color, mHi));
+        __m128i invLo = _mm_sub_epi16(full, Div255Epi16(_mm_mullo_epi16(alpha, mLo)));
+        __m128i invHi = _mm_sub_epi16(full, Div255Epi16(_mm_mullo_epi16(alpha, mHi)));
+        __m128i dLo = _mm_add_epi16(sLo, Div255Epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invLo)));
+        __m128i dHi = _mm_add_epi16(sHi, Div255Epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invHi)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(dLo, dHi));
+    }
+    _RGBQUAD c;
+    c.rgb = pixel;
+    for (; i < count; i++) {
+        DWORD m = mask[i];
+        if (m == 0) {
+            continue;
+        }
+        DWORD inv = 255 - Div255(c.a * m);
+        dst[i].b = (BYTE)min(255u, Div255(c.b * m) + Div255(dst[i].b * inv));
+        dst[i].g = (BYTE)min(255u, Div255(c.g * m) + Div255(dst[i].g * inv));
+        dst[i].r = (BYTE)min(255u, Div255(c.r * m) + Div255(dst[i].r * inv));
+        dst[i].a = (BYTE)min(255u, Div255(c.a * m) + Div255(dst[i].a * inv));
+    }
+}
+
+// 用同一个像素值填充一段像素
+inline void FillSpan(PRGBQUAD dst, DWORD pixel, int count) {
+    const __m128i value = _mm_set1_epi32((int)pixel);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), value);
+    }
+    for (; i < count; i++) {
+        dst[i].rgb = pixel;
+    }
+}
+
+// 32位像素表面：自上而下的 DIB，第 y 行就是屏幕上的第 y 行，可以直接和 GDI 互相拷贝
+class Surface {
+public:
+    HDC hdcMem;              // 内存设备上下文（包装外部像素时为 NULL）
+    HBITMAP hbmTemp;         // DIB 位图
+    PRGBQUAD pixels;         // 像素数组，第 y 行从 pixels + y * width 开始
+    int width;               // 宽度
+    int height;              // 高度
+
+    Surface() : hdcMem(NULL), hbmTemp(NULL), pixels(NULL), width(0), height(0) {
+    }
+    Surface(int width, int height) : Surface() {
+        Create(width, height);
+    }
+    // 包装一块已有的像素数组（例如 ScreenGDI::rgbScreen），不负责释放
+    Surface(PRGBQUAD pixels, int width, int height) : hdcMem(NULL), hbmTemp(NULL), pixels(pixels), width(width), height(height) {
+    }
+    ~Surface() {
+        Release();
+    }
+    Surface(const Surface&) = delete;
+    Surface& operator=(const Surface&) = delete;
+    Surface(Surface&& other) : hdcMem(other.hdcMem), hbmTemp(other.hbmTemp), pixels(other.pixels), width(other.width), height(other.height) {
+        other.hdcMem = NULL;
+        other.hbmTemp = NULL;
+        other.pixels = NULL;
+        other.width = other.height = 0;
+    }
+    Surface& operator=(Surface&& other) {
+        if (this != &other) {
+            Release();
+            hdcMem = other.hdcMem;
+            hbmTemp = other.hbmTemp;
+            pixels = other.pixels;
+            width = other.width;
+            height = other.height;
+            other.hdcMem = NULL;
+            other.hbmTemp = NULL;
+            other.pixels = NULL;
+            other.width = other.height = 0;
+        }
+        return *this;
+    }
+
+    void Create(int newWidth, int newHeight) {
+        Release();
+        if (newWidth <= 0 || newHeight <= 0) {
+            return;
+        }
+        hdcMem = CreateCompatibleDC(NULL);
+
+        // 高度取负数得到自上而下的位图
+        BITMAPINFO bmi = { 0 };
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biWidth = newWidth;
+        bmi.bmiHeader.biHeight = -newHeight;
+        hbmTemp = CreateDIBSection(hdcMem, &bmi, DIB_RGB_COLORS, (void**)&pixels, NULL, 0);
+        if (hbmTemp == NULL) {
+            DeleteDC(hdcMem);
+            hdcMem = NULL;
+            pixels = NULL;
+            return;
+        }
+        SelectObject(hdcMem, hbmTemp);
+        width = newWidth;
+        height = newHeight;
+    }
+    void Release() {
+        if (hdcMem != NULL) {
+            DeleteDC(hdcMem);
+        }
+        if (hbmTemp != NULL) {
+            DeleteObject(hbmTemp);
+        }
+        hdcMem = NULL;
+        hbmTemp = NULL;
+        pixels = NULL;
+        width = height = 0;
+    }
+
+    bool Empty() const {
+        return pixels == NULL;
+    }
+    size_t Bytes() const {
+        return (size_t)width * height * sizeof(_RGBQUAD);
+    }
+    PRGBQUAD Row(int y) const {
+        return pixels + (size_t)y * width;
+    }
+    // 从设备上下文的 (x, y) 处拷贝一块和表面一样大的区域
+    void Capture(HDC hdc, int x = 0, int y = 0) {
+        BitBlt(hdcMem, 0, 0, width, height, hdc, x, y, SRCCOPY);
+        GdiFlush();
+    }
+    // 只拷贝设备上下文的一部分到表面的 (dstX, dstY) 处
+    void Capture(HDC hdc, int x, int y, int dstX, int dstY, int w, int h) {
+        BitBlt(hdcMem, dstX, dstY, w, h, hdc, x, y, SRCCOPY);
+        GdiFlush();
+    }
+    // 把表面拷贝到设备上下文的 (x, y) 处
+    void Present(HDC hdc, int x = 0, int y = 0) const {
+        BitBlt(hdc, x, y, width, height, hdcMem, 0, 0, SRCCOPY);
+    }
+    // 只把表面上 (srcX, srcY) 开始的 w x h 区域拷贝到设备上下文的 (x, y) 处
+    void Present(HDC hdc, int x, int y, int srcX, int srcY, int w, int h) const {
+        BitBlt(hdc, x, y, w, h, hdcMem, srcX, srcY, SRCCOPY);
+    }
+    // 用像素值（见 ToPixel）填满整个表面
+    void Clear(DWORD pixel = 0) {
+        if (pixel == 0) {
+            memset(pixels, 0, Bytes());
+            return;
+        }
+        for (int y = 0; y < height; y++) {
+            FillSpan(Row(y), pixel, width);
+        }
+    }
+};
+
+// 对表面的每个像素调用 func(_RGBQUAD& pixel)，按行分给多个线程；func 不能依赖其他像素
+template <typename PixelFunc>
+inline void ForEachPixel(Surface& surface, PixelFunc func) {
+    ParallelFor(surface.height, [&surface, &func](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            PRGBQUAD row = surface.Row(y);
+            for (int x = 0; x < surface.width; x++) {
+                func(row[x]);
+            }
+        }
+    }, 16);
+}
+
+// 临时表面池：按尺寸复用之前创建过的表面，每帧都要用的中间结果不用反复 CreateDIBSection
+class SurfacePool {
+public:
+    // 取一块 width x height 的表面（内容不确定），用完后交还给 Release
+    Surface& Acquire(int width, int height) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].used && entries[i].surface->width == width && entries[i].surface->height == height) {
+                entries[i].used = true;
+                return *entries[i].surface;
+            }
+        }
+        Entry entry;
+        entry.surface.reset(new Surface(width, height));
+        entry.used = true;
+        entries.push_back(std::move(entry));
+        return *entries.back().surface;
+    }
+    void Release(Surface& surface) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].surface.get() == &surface) {
+                entries[i].used = false;
+                return;
+            }
+        }
+    }
+    // 释放所有空闲的表面
+    void Trim() {
+        size_t kept = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].used) {
+                if (kept != i) {
+                    entries[kept] = std::move(entries[i]);
+                }
+                kept++;
+            }
+        }
+        entries.resize(kept);
+    }
+
+private:
+    struct Entry {
+        std::unique_ptr<Surface> surface;
+        bool used;
+    };
+    std::vector<Entry> entries;
+};
+
+// 最近几帧画面的环形缓冲：Push 拷入一帧（覆盖最旧的一帧），Get(0) 是最近拷入的一帧，Get(1) 是再前一帧……
+// 需要和前一帧比较或混合的效果（拖影、数据损坏）共用它，每帧只有一次整帧拷贝，不会重新创建位图
+class FrameHistory {
+public:
+    explicit FrameHistory(int depth = 2) : next(0), count(0) {
+        for (int i = 0; i < max(1, depth); i++) {
+            frames.push_back(std::unique_ptr<Surface>(new Surface()));
+        }
+    }
+    int Depth() const {
+        return (int)frames.size();
+    }
+    int Count() const {
+        return count;
+    }
+    void Push(const Surface& frame) {
+        Surface& slot = *frames[next];
+        if (slot.width != frame.width || slot.height != frame.height) {
+            slot.Create(frame.width, frame.height);
+        }
+        // 内存不够创建不出位图时丢掉这一帧
+        if (slot.Empty()) {
+            return;
+        }
+        for (int y = 0; y < frame.height; y++) {
+            memcpy(slot.Row(y), frame.Row(y), frame.width * sizeof(_RGBQUAD));
+        }
+        next = (next + 1) % Depth();
+        count = min(count + 1, Depth());
+    }
+    // age 帧以前的画面，还没有那么多帧时返回 NULL
+    const Surface* Get(int age) const {
+        if (age < 0 || age >= count) {
+            return NULL;
+        }
+        return frames[(next - 1 - age + Depth() * 2) % Depth()].get();
+    }
+    void Clear() {
+        next = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<Surface>> frames;
+    int next;
+    int count;
+};
@@ -0,0 +1,409 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "surface.hpp"
+
+// 内置 8x8 点阵字体（ASCII 0x20～0x7E），没有可用字体时使用
+// 每个字符 8 行，每行的最低位是最左边的像素
+static const BYTE BUILTIN_FONT_8X8[95][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },  // '!'
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '"'
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },  // '#'
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },  // '$'
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },  // '%'
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },  // '&'
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '''
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },  // '('
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },  // ')'
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },  // '*'
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },  // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },  // ','
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },  // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },  // '.'
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },  // '/'
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },  // '0'
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },  // '1'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },  // '2'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },  // '3'
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },  // '4'
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },  // '5'
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },  // '6'
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },  // '7'
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },  // '8'
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },  // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },  // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },  // ';'
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },  // '<'
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },  // '='
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },  // '>'
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },  // '?'
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },  // '@'
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },  // 'A'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },  // 'B'
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },  // 'C'
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },  // 'D'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },  // 'E'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },  // 'F'
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },  // 'G'
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },  // 'H'
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'I'
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },  // 'J'
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },  // 'K'
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },  // 'L'
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },  // 'M'
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },  // 'N'
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },  // 'O'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },  // 'P'
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },  // 'Q'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },  // 'R'
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },  // 'S'
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'T'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },  // 'U'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },  // 'V'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },  // 'W'
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },  // 'X'
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },  // 'Y'
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },  // 'Z'
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },  // '['
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },  // '\'
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },  // ']'
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },  // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },  // '_'
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '`'
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },  // 'a'
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },  // 'b'
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },  // 'c'
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },  // 'd'
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },  // 'e'
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },  // 'f'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },  // 'g'
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },  // 'h'
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'i'
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },  // 'j'
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },  // 'k'
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'l'
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },  // 'm'
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },  // 'n'
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },  // 'o'
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },  // 'p'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },  // 'q'
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },  // 'r'
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },  // 's'
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },  // 't'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },  // 'u'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },  // 'v'
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },  // 'w'
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },  // 'x'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },  // 'y'
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },  // 'z'
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },  // '{'
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },  // '|'
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },  // '}'
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '~'
+};
+
+// 字形缓存：每个 (字体, 字号, 字符) 只光栅化一次，灰度覆盖率放进同一张图集
+// 字体用 GetGlyphOutlineW 取 8 位灰度字形；字体不可用（或没有窗口环境）时改用内置点阵字体
+// 排版时只查缓存里的步进宽度，绘制时逐行用 SIMD 按覆盖率混合到 Surface 上
+class GlyphCache {
+public:
+    struct Glyph {
+        int atlasX;     // 在图集中的位置
+        int atlasY;
+        int width;      // 字形位图大小（空白字符为 0）
+        int height;
+        int offsetX;    // 位图左上角相对于笔位置（行顶部）的偏移
+        int offsetY;
+        int advance;    // 笔位置前进的距离
+    };
+
+    GlyphCache(int atlasWidth = 1024, int maxAtlasHeight = 4096)
+        : atlasWidth(atlasWidth), maxAtlasHeight(maxAtlasHeight), atlasHeight(0), shelfX(0), shelfY(0), shelfHeight(0), hdcMem(NULL) {
+    }
+    ~GlyphCache() {
+        // 最后用过的字体还选在 hdcMem 里，选着的字体 DeleteObject 会失败，所以先删 DC 再删字体
+        if (hdcMem != NULL) {
+            DeleteDC(hdcMem);
+        }
+        for (size_t i = 0; i < fonts.size(); i++) {
+            if (fonts[i].font != NULL) {
+                DeleteObject(fonts[i].font);
+            }
+        }
+    }
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    // 取得 (字体名, 字号) 对应的字体编号，face 为 NULL 或空串时使用内置点阵字体
+    int GetFont(const wchar_t* face, int size) {
+        std::wstring name = face != NULL ? face : L"";
+        size = max(1, size);
+        for (size_t i = 0; i < fonts.size(); i++) {
+            if (fonts[i].size == size && fonts[i].face == name) {
+                return static_cast<int>(i);
+            }
+        }
+        Font font;
+        font.face = name;
+        font.size = size;
+        font.font = NULL;
+        font.scale = max(1, (size + 4) / 8);
+        font.ascent = 7 * font.scale;
+        font.lineHeight = 8 * font.scale;
+        if (!name.empty()) {
+            if (hdcMem == NULL) {
+                hdcMem = CreateCompatibleDC(NULL);
+            }
+            font.font = CreateFontW(size, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, name.c_str());
+            TEXTMETRICW metrics;
+            if (font.font != NULL && hdcMem != NULL) {
+                SelectObject(hdcMem, font.font);
+                if (GetTextMetricsW(hdcMem, &metrics)) {
+                    font.ascent = metrics.tmAscent;
+                    font.lineHeight = metrics.tmHeight;
+                }
+            }
+        }
+        fonts.push_back(font);
+        return static_cast<int>(fonts.size()) - 1;
+    }
+
+    int LineHeight(int font) const {
+        return fonts[font].lineHeight;
+    }
+
+    const Glyph& GetGlyph(int font, wchar_t ch) {
+        Font& f = fonts[font];
+        if (ch < 128 && f.ascii[ch] >= 0) {
+            return f.glyphs[f.ascii[ch]];
+        }
+        if (ch >= 128) {
+            std::unordered_map<wchar_t, int>::const_iterator it = f.others.find(ch);
+            if (it != f.others.end()) {
+                return f.glyphs[it->second];
+            }
+        }
+        Glyph glyph;
+        if (f.font == NULL || !RasterizeOutline(f, ch, glyph)) {
+            RasterizeBuiltin(f, ch, glyph);
+        }
+        // 图集满了：丢掉所有字形从头开始，之后用到的字形会重新光栅化
+        if (glyph.atlasY < 0) {
+            if (!atlas.empty()) {
+                Reset();
+                return GetGlyph(font, ch);
+            }
+            glyph.width = 0;    // 比整张图集还大的字形只保留步进宽度
+            glyph.height = 0;
+            glyph.atlasY = 0;
+        }
+        int index = static_cast<int>(f.glyphs.size());
+        f.glyphs.push_back(glyph);
+        if (ch < 128) {
+            f.ascii[ch] = index;
+        }
+        else {
+            f.others[ch] = index;
+        }
+        return f.glyphs[index];
+    }
+
+    // 文本宽度（像素），只用缓存里的步进宽度
+    int Measure(int font, const wchar_t* text, int length) {
+        int width = 0;
+        for (int i = 0; i < length; i++) {
+            width += GetGlyph(font, text[i]).advance;
+        }
+        return width;
+    }
+
+    // 以 (x, y) 为第一行的左上角画出文本，'\n' 换行；返回最后的笔位置 x
+    int DrawString(Surface& target, int x, int y, int font, const wchar_t* text, int length, COLORREF color, BYTE alpha = 255) {
+        DWORD pixel = ToPixel(color, alpha);
+        int penX = x;
+        for (int i = 0; i < length; i++) {
+            if (text[i] == L'\n') {
+                penX = x;
+                y += fonts[font].lineHeight;
+                continue;
+            }
+            const Glyph& glyph = GetGlyph(font, text[i]);
+            BlitGlyph(target, penX + glyph.offsetX, y + glyph.offsetY, glyph, pixel);
+            penX += glyph.advance;
+        }
+        return penX;
+    }
+
+    void Reset() {
+        for (size_t i = 0; i < fonts.size(); i++) {
+            fonts[i].glyphs.clear();
+            fonts[i].others.clear();
+            memset(fonts[i].ascii, -1, sizeof(fonts[i].ascii));
+        }
+        atlas.clear();
+        atlasHeight = 0;
+        shelfX = 0;
+        shelfY = 0;
+        shelfHeight = 0;
+    }
+
+    size_t MemoryUsed() const {
+        return atlas.size();
+    }
+    int AtlasStride() const {
+        return atlasWidth;
+    }
+    // 字形位图第 row 行的覆盖率（宽度为 glyph.width）
+    const BYTE* AtlasRow(const Glyph& glyph, int row) const {
+        return &atlas[static_cast<size_t>(glyph.atlasY + row) * atlasWidth + glyph.atlasX];
+    }
+
+private:
+    struct Font {
+        std::wstring face;
+        int size;
+        HFONT font;
+        int scale;          // 内置点阵字体的放大倍数
+        int ascent;
+        int lineHeight;
+        int ascii[128];     // ASCII 字符直接查表，-1 表示还没光栅化
+        std::unordered_map<wchar_t, int> others;
+        std::vector<Glyph> glyphs;
+
+        Font() {
+            memset(ascii, -1, sizeof(ascii));
+        }
+    };
+
+    int atlasWidth;
+    int maxAtlasHeight;
+    int atlasHeight;
+    std::vector<BYTE> atlas;    // 8 位覆盖率图集，按货架（shelf）方式从上到下排放字形
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+    HDC hdcMem;
+    std::vector<Font> fonts;
+
+    // 在图集里分配 w x h 的空间，装不下时 x, y 返回 -1
+    void Allocate(int w, int h, int& x, int& y) {
+        if (w <= 0 || h <= 0) {
+            x = 0;
+            y = 0;
+            return;
+        }
+        if (w > atlasWidth) {
+            x = y = -1;
+            return;
+        }
+        if (shelfX + w > atlasWidth) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        if (shelfY + h > maxAtlasHeight) {
+            x = y = -1;
+            return;
+        }
+        if (shelfY + h > atlasHeight) {
+            atlasHeight = min(maxAtlasHeight, max(shelfY + h, atlasHeight * 2));
+            atlas.resize(static_cast<size_t>(atlasWidth) * atlasHeight);
+        }
+        x = shelfX;
+        y = shelfY;
+        shelfX += w;
+        shelfHeight = max(shelfHeight, h);
+    }
+
+    bool RasterizeOutline(Font& f, wchar_t ch, Glyph& glyph) {
+        static const MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+        GLYPHMETRICS gm;
+        SelectObject(hdcMem, f.font);
+        DWORD size = GetGlyphOutlineW(hdcMem, ch, GGO_GRAY8_BITMAP, &gm, 0, NULL, &identity);
+        if (size == GDI_ERROR) {
+            return false;
+        }
+        glyph.offsetX = gm.gmptGlyphOrigin.x;
+        glyph.offsetY = f.ascent - gm.gmptGlyphOrigin.y;
+        glyph.advance = gm.gmCellIncX;
+        glyph.width = 0;
+        glyph.height = 0;
+        glyph.atlasX = 0;
+        glyph.atlasY = 0;
+        if (size == 0) {
+            return true;    // 空白字符只有步进宽度
+        }
+        std::vector<BYTE> bits(size);
+        if (GetGlyphOutlineW(hdcMem, ch, GGO_GRAY8_BITMAP, &gm, size, bits.data(), &identity) == GDI_ERROR) {
+            return false;
+        }
+        int w = gm.gmBlackBoxX;
+        int h = gm.gmBlackBoxY;
+        int pitch = (w + 3) & ~3;   // 每行按 DWORD 对齐
+        Allocate(w, h, glyph.atlasX, glyph.atlasY);
+        if (glyph.atlasY < 0) {
+            return true;
+        }
+        glyph.width = w;
+        glyph.height = h;
+        // GGO_GRAY8_BITMAP 的灰度是 0～64，换算成 0～255
+        for (int y = 0; y < h; y++) {
+            BYTE* dst = &atlas[static_cast<size_t>(glyph.atlasY + y) * atlasWidth + glyph.atlasX];
+            const BYTE* src = &bits[y * pitch];
+            for (int x = 0; x < w; x++) {
+                dst[x] = static_cast<BYTE>(min(255, (src[x] * 255 + 32) / 64));
+            }
+        }
+        return true;
+    }
+
+    void RasterizeBuiltin(Font& f, wchar_t ch, Glyph& glyph) {
+        if (ch < 0x20 || ch > 0x7E) {
+            ch = ch == L'\t' || ch == L' ' ? L' ' : L'?';
+        }
+        const BYTE* rows = BUILTIN_FONT_8X8[ch - 0x20];
+        int s = f.scale;
+        glyph.offsetX = 0;
+        glyph.offsetY = f.ascent - 7 * s;
+        glyph.advance = 8 * s;
+        glyph.width = 0;
+        glyph.height = 0;
+        glyph.atlasX = 0;
+        glyph.atlasY = 0;
+        if (ch == L' ') {
+            return;
+        }
+        Allocate(8 * s, 8 * s, glyph.atlasX, glyph.atlasY);
+        if (glyph.atlasY < 0) {
+            return;
+        }
+        glyph.width = 8 * s;
+        glyph.height = 8 * s;
+        for (int y = 0; y < 8 * s; y++) {
+            BYTE* dst = &atlas[static_cast<size_t>(glyph.atlasY + y) * atlasWidth + glyph.atlasX];
+            BYTE bitsRow = rows[y / s];
+            for (int x = 0; x < 8 * s; x++) {
+                dst[x] = (bitsRow >> (x / s)) & 1 ? 255 : 0;
+            }
+        }
+    }
+
+    void BlitGlyph(Surface& target, int x, int y, const Glyph& glyph, DWORD pixel) {
+        int x0 = max(0, x);
+        int y0 = max(0, y);
+        int x1 = min(target.width, x + glyph.width);
+        int y1 = min(target.height, y + glyph.height);
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        for (int row = y0; row < y1; row++) {
+            const BYTE* mask = &atlas[static_cast<size_t>(glyph.atlasY + row - y) * atlasWidth + glyph.atlasX + x0 - x];
+            BlendMaskSpan(target.Row(row) + x0, pixel, mask, x1 - x0);
+        }
+    }
+};
@@ -0,0 +1,151 @@
+﻿#pragma once
+#include <Windows.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <emmintrin.h>
+#include "surface.hpp"
+#include "parallel.hpp"
+
+// 32 位像素的转置：dst[x * dstStride + y] = src[y * srcStride + x]
+// 区域不断对半切开直到能放进一级缓存（缓存无关的分治），小块内部用 SSE2 一次转置 4x4 个像素
+
+// 转置一个 4x4 像素块
+inline void Transpose4x4(const _RGBQUAD* src, int srcStride, PRGBQUAD dst, int dstStride) {
+    __m128i r0 = _mm_loadu_si128((const __m128i*)src);
+    __m128i r1 = _mm_loadu_si128((const __m128i*)(src + srcStride));
+    __m128i r2 = _mm_loadu_si128((const __m128i*)(src + srcStride * 2));
+    __m128i r3 = _mm_loadu_si128((const __m128i*)(src + srcStride * 3));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(dst + dstStride), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i*)(dst + dstStride * 2), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i*)(dst + dstStride * 3), _mm_unpackhi_epi64(t2, t3));
+}
+
+// 一块足够小的区域：整 4x4 块用 SIMD，右 / 下不满 4 的边角逐个像素处理
+inline void TransposeSmall(const _RGBQUAD* src, int srcStride, PRGBQUAD dst, int dstStride, int w, int h) {
+    int w4 = w & ~3;
+    int h4 = h & ~3;
+    for (int y = 0; y < h4; y += 4) {
+        for (int x = 0; x < w4; x += 4) {
+            Transpose4x4(src + (size_t)y * srcStride + x, srcStride, dst + (size_t)x * dstStride + y, dstStride);
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = y < h4 ? w4 : 0; x < w; x++) {
+            dst[(size_t)x * dstStride + y] = src[(size_t)y * srcStride + x];
+        }
+    }
+}
+
+// 转置 w x h 的区域：长的一边对半切开（切点对齐到 4），直到区域不超过 32x32 个像素
+inline void TransposeRegion(const _RGBQUAD* src, int srcStride, PRGBQUAD dst, int dstStride, int w, int h) {
+    if (w <= 32 && h <= 32) {
+        TransposeSmall(src, srcStride, dst, dstStride, w, h);
+    }
+    else if (w >= h) {
+        int half = (w / 2 + 3) & ~3;
+        TransposeRegion(src, srcStride, dst, dstStride, half, h);
+        TransposeRegion(src + half, srcStride, dst + (size_t)half * dstStride, dstStride, w - half, h);
+    }
+    else {
+        int half = (h / 2 + 3) & ~3;
+        TransposeRegion(src, srcStride, dst, dstStride, w, half);
+        TransposeRegion(src + (size_t)half * srcStride, srcStride, dst + half, dstStride, w, h - half);
+    }
+}
+
+// 把 source 转置到 target（宽高和 source 对调，不一致时重新创建），按 64 行一条分给多个线程
+inline void Transpose(const Surface& source, Surface& target) {
+    if (source.Empty()) {
+        return;
+    }
+    if (target.width != source.height || target.height != source.width) {
+        target.Create(source.height, source.width);
+    }
+    const int strip = 64;
+    ParallelFor((source.height + strip - 1) / strip, [&source, &target, strip](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int y0 = i * strip;
+            TransposeRegion(source.Row(y0), source.width, target.pixels + y0, target.width,
+                source.width, min(strip, source.height - y0));
+        }
+    }, 1);
+}
+
+// 一次转置到临时缓冲里的列数：缓冲大小为 COLUMN_BAND x 高度
+const int COLUMN_BAND = 32;
+
+// 按列带处理：每次把一条列带（最多 COLUMN_BAND 列）转置到连续的临时缓冲里，调用 func(band, columns, length, x0, state)，再转置回去
+// band 里第 i 列从 band + i * length 开始，是第 x0 + i 列从上到下的 length 个像素
+// 每个线程默认构造一个 State，在它处理的各列带之间复用（例如放临时缓冲）
+template <typename State, typename BandFunc>
+inline void ProcessColumnBands(Surface& surface, BandFunc func) {
+    if (surface.Empty()) {
+        return;
+    }
+    int h = surface.height;
+    int bands = (surface.width + COLUMN_BAND - 1) / COLUMN_BAND;
+    ParallelFor(bands, [&surface, &func, h](int begin, int end) {
+        std::vector<_RGBQUAD> scratch((size_t)COLUMN_BAND * h);
+        State state;
+        for (int band = begin; band < end; band++) {
+            int x0 = band * COLUMN_BAND;
+            int n = min(COLUMN_BAND, surface.width - x0);
+            TransposeRegion(surface.Row(0) + x0, surface.width, scratch.data(), h, n, h);
+            func(scratch.data(), n, h, x0, state);
+            TransposeRegion(scratch.data(), h, surface.Row(0) + x0, surface.width, h, n);
+        }
+    }, 1);
+}
+
+// 按列处理：对每一列调用 func(column, length, x)，column 是第 x 列从上到下的 length 个像素，
+// func 可以像处理一行那样顺序读写它，不用跨着整行的步长跳
+template <typename ColumnFunc>
+inline void ProcessColumnsAsRows(Surface& surface, ColumnFunc func) {
+    ProcessColumnBands<int>(surface, [&func](PRGBQUAD band, int columns, int length, int x0, int&) {
+        for (int i = 0; i < columns; i++) {
+            func(band + (size_t)i * length, length, x0 + i);
+        }
+    });
+}
+
+// 同上，但调用 func(column, length, state)，state 是当前线程的 State，用来复用每列都要的临时缓冲
+template <typename State, typename ColumnFunc>
+inline void ProcessColumnsAsRowsWithState(Surface& surface, ColumnFunc func) {
+    ProcessColumnBands<State>(surface, [&func](PRGBQUAD band, int columns, int length, int, State& state) {
+        for (int i = 0; i < columns; i++) {
+            func(band + (size_t)i * length, length, state);
+        }
+    });
+}
+
+// 每一列向下移动 offset(x) 个像素（负数向上），可以做竖直波浪、融化之类的效果
+// wrap 为 true 时移出底边的像素从顶上绕回来；否则顶上空出的部分重复原来的第一个像素，像往下流一样
+template <typename OffsetFunc>
+inline void ShiftColumns(Surface& surface, OffsetFunc offset, bool wrap = true) {
+    ProcessColumnsAsRows(surface, [&offset, wrap](PRGBQUAD column, int length, int x) {
+        int shift = offset(x);
+        if (wrap) {
+            shift %= length;
+            if (shift < 0) {
+                shift += length;
+            }
+            std::rotate(column, column + (length - shift), column + length);
+        }
+        else if (shift > 0) {
+            shift = min(shift, length);
+            memmove(column + shift, column, (length - shift) * sizeof(_RGBQUAD));
+            std::fill(column + 1, column + shift, column[0]);
+        }
+        else if (shift < 0) {
+            shift = min(-shift, length);
+            memmove(column, column + shift, (length - shift) * sizeof(_RGBQUAD));
+            std::fill(column + length - shift, column + length - 1, column[length - 1]);
+        }
+    });
+}
@@ -2,9 +2,15 @@
 #include <windows.h>
 #include <math.h>
 #include <iostream>
+#include <vector>
+#include "EvilockGDI/sprite.hpp"
+#include "EvilockGDI/raster.hpp"
+#include "EvilockGDI/path.hpp"
+#include "EvilockGDI/fill.hpp"
+#include "EvilockGDI/text.hpp"
 constexpr float CCW = -1;//ʱ
 constexpr float CW = 1;//˳ʱ 
-constexpr float PI = 3.141;
+constexpr int FRAME_TIME = 16;//ʱÿ֡ļ룩
 
 class IconDrawer {
 private:
@@ -12,47 +18,82 @@ private:
     HICON icon;
     bool penState;//״̬
     int sensitivity;//ȣͼ
-    int penSpeed;//ٶ
+    int penSpeed;//ٶȣÿͼʾļ룬0Ϊʾ
     POINT center;//
+    RECT canvas;//ΧΧͼֱ޳
     int iconWidth;  // ͼ
     int iconHeight;  // ͼ߶
+    bool rotateStamps;//ͼǷǰת
+    SpriteCache sprites;//ת/źͼ껺
+    Surface batch;//ϳһͼõڴ滭
+    bool strokeMode;//Ϊʱʻͼ
+    COLORREF strokeColor;//ɫ
+    float strokeWidth;//
+    bool filling;//beginFill  endFill ֮Ϊ棬ʾ·ᱻ¼
+    Path fillPath;//
+    GlyphCache glyphs;//drawText õͼ
+
+    // ʾͼλãSoA ֣ɶʱӰʾ
+    std::vector<float> stampX;
+    std::vector<float> stampY;
+    std::vector<float> stampAngle;
+    size_t revealed;//Ѿͼ
+    size_t clockIndex;//ʱӦͼ
+    ULONGLONG clockStart;//ʱ
 
 public:
     POINT position;
     float angle;
-    IconDrawer(HDC hdc = GetDC(NULL), HICON icon = LoadIcon(NULL, IDI_ERROR)) : hdc(hdc), icon(icon), penState(true), sensitivity(10), penSpeed(10) {
-        RECT rect;
-        GetClientRect(WindowFromDC(hdc), &rect);
-        center.x = rect.right / 2;
-        center.y = rect.bottom / 2;
+    IconDrawer(HDC hdc = GetDC(NULL), HICON icon = LoadIcon(NULL, IDI_ERROR)) : hdc(hdc), icon(icon), penState(true), sensitivity(10), penSpeed(10), iconWidth(0), iconHeight(0), rotateStamps(false), strokeMode(false), strokeColor(RGB(0, 0, 0)), strokeWidth(2.0f), filling(false), revealed(0), clockIndex(0), clockStart(0) {
+        GetClientRect(WindowFromDC(hdc), &canvas);
+        center.x = canvas.right / 2;
+        center.y = canvas.bottom / 2;
         position = center;
         angle = 0;
     }
+    ~IconDrawer() {
+        finish();
+    }
 
 
     void forward(int distance) {
-        int steps = distance / sensitivity;
-        float stepX = distance * cos(angle) / steps;
-        float stepY = distance * sin(angle) / steps;
+        // һ·ϵͼλãֻһ sin/cos
+        float dirX = cos(angle);
+        float dirY = sin(angle);
+        float startX = static_cast<float>(position.x);
+        float startY = static_cast<float>(position.y);
 
-        for (int i = 0; i < steps; i++) {
-            position.x += stepX;
-            position.y += stepY;
-            if (penState) {
-                DrawIcon(position.x, position.y);
+        if (penState && distance > 0 && strokeMode) {
+            float endX = startX + distance * dirX;
+            float endY = startY + distance * dirY;
+            strokeRegion(min(startX, endX), min(startY, endY), max(startX, endX), max(startY, endY), [&](Rasterizer& raster) {
+                raster.DrawLine(startX, startY, endX, endY);
+            });
+        }
+        else if (penState && distance > 0) {
+            int steps = max(1, distance / sensitivity);
+            float stepX = distance * dirX / steps;
+            float stepY = distance * dirY / steps;
+            reserveStamps(steps);
+            for (int i = 1; i <= steps; i++) {
+                queueStamp(startX + stepX * i, startY + stepY * i, angle);
             }
         }
 
-        position.x += (distance - steps * sensitivity) * cos(angle);
-        position.y += (distance - steps * sensitivity) * sin(angle);
-        if (penState) {
-            DrawIcon(position.x, position.y);
+        if (filling) {
+            fillPath.LineTo(startX + distance * dirX, startY + distance * dirY);
         }
+        position.x = static_cast<LONG>(lround(startX + distance * dirX));
+        position.y = static_cast<LONG>(lround(startY + distance * dirY));
+        update();
     }
 
     void gotoPos(int newX, int newY) {
         position.x = newX;
         position.y = newY;
+        if (filling) {
+            fillPath.LineTo(static_cast<float>(newX), static_cast<float>(newY));
+        }
     }
 
     void rotate(float degrees) {
@@ -74,11 +115,14 @@ public:
     }
 
     void setSensitivity(int newSensitivity) {
-        sensitivity = newSensitivity;
+        sensitivity = max(1, newSensitivity);
     }
 
     void setPenSpeed(int newPenSpeed) {
-        penSpeed = newPenSpeed;
+        // ԵǰΪ¼ʱŶӵͼ갴ٶȼʾ
+        penSpeed = max(0, newPenSpeed);
+        clockIndex = revealed;
+        clockStart = GetTickCount64();
     }
 
     void penUp() {
@@ -89,7 +133,20 @@ public:
         penState = true;
     }
 
+    // ÿͼ갴ǰǰתԲʱ߷
+    void setStampRotation(bool enabled) {
+        rotateStamps = enabled;
+    }
+
+    // 󻭱ʻɫ color widthرպָͼ
+    void setStrokeMode(bool enabled, COLORREF color = RGB(0, 0, 0), float width = 2.0f) {
+        strokeMode = enabled;
+        strokeColor = color;
+        strokeWidth = width;
+    }
+
     void changeIcon(HICON newIcon) {
+        finish();
         icon = newIcon;
     }
 
@@ -106,58 +163,227 @@ public:
     }
 
     void drawCircle(int radius) {
-        int centerX = position.x;
-        int centerY = position.y;
+        if (radius <= 0) {
+            return;
+        }
+        float centerX = static_cast<float>(position.x);
+        float centerY = static_cast<float>(position.y);
+        if (filling) {
+            // ԲΪһպصǰλü¼
+            fillPath.MoveTo(centerX + radius, centerY);
+            recordArc(centerX, centerY, static_cast<float>(radius), 0.0f, static_cast<float>(2 * PI));
+            fillPath.Close();
+            fillPath.MoveTo(centerX, centerY);
+        }
+        if (strokeMode) {
+            float r = static_cast<float>(radius);
+            strokeRegion(centerX - r, centerY - r, centerX + r, centerY + r, [&](Rasterizer& raster) {
+                raster.DrawCircle(centerX, centerY, r);
+            });
+            return;
+        }
 
-        float angleIncrement = sensitivity / static_cast<float>(radius);
+        // ȷֲ಻ sensitivity ͼβص
+        // תÿһͬһתת뾶 sin/cos
+        int steps = max(3, static_cast<int>(ceil(2 * PI * radius / sensitivity)));
+        float angleIncrement = static_cast<float>(2 * PI / steps);
+        float stepCos = cos(angleIncrement);
+        float stepSin = sin(angleIncrement);
+        float dx = static_cast<float>(radius);
+        float dy = 0.0f;
 
-        for (float angle = 0.0; angle <= 2 * PI; angle += angleIncrement) {
-            int xx = static_cast<int>(centerX + radius * cos(angle));
-            int yy = static_cast<int>(centerY + radius * sin(angle));
-            DrawIcon(xx, yy);
+        reserveStamps(steps);
+        for (int i = 0; i < steps; i++) {
+            queueStamp(centerX + dx, centerY + dy, angleIncrement * i + PI / 2);
+            float nx = dx * stepCos - dy * stepSin;
+            dy = dx * stepSin + dy * stepCos;
+            dx = nx;
         }
+        update();
     }
 
-    void drawArc(int radius, float angle, float direction) {
-        float arcLength = 2 * PI * radius * (angle / 360.0);
-        int numSegments = static_cast<int>(arcLength / sensitivity);
-        angle = direction * angle;
-        float angleIncrement = angle / numSegments;
+    // ذ뾶Ϊ radius Բǰ sweep ȣdirection Ϊ CW ʱתCCW ʱת
+    void drawArc(int radius, float sweep, float direction) {
+        if (radius <= 0 || sweep == 0) {
+            return;
+        }
+        float sweepRad = static_cast<float>(direction * sweep * (PI / 180.0));
+        // ԲǰҲࣨCWࣨCCW
+        float normal = static_cast<float>(angle + direction * PI / 2);
+        float centerX = position.x + radius * cos(normal);
+        float centerY = position.y + radius * sin(normal);
+        float startPhi = static_cast<float>(normal + PI);
+
+        if (penState && strokeMode) {
+            float r = static_cast<float>(radius);
+            float startDegrees = static_cast<float>(startPhi * 180.0 / PI);
+            strokeRegion(centerX - r, centerY - r, centerX + r, centerY + r, [&](Rasterizer& raster) {
+                raster.DrawArc(centerX, centerY, r, startDegrees, direction * sweep);
+            });
+        }
+        else if (penState) {
+            //  drawCircle һȷֲ
+            int steps = max(1, static_cast<int>(ceil(fabs(sweepRad) * radius / sensitivity)));
+            float step = sweepRad / steps;
+            float stepCos = cos(step);
+            float stepSin = sin(step);
+            float dx = radius * cos(startPhi);
+            float dy = radius * sin(startPhi);
+            reserveStamps(steps);
+            for (int i = 1; i <= steps; i++) {
+                float nx = dx * stepCos - dy * stepSin;
+                dy = dx * stepSin + dy * stepCos;
+                dx = nx;
+                queueStamp(centerX + dx, centerY + dy, angle + step * i);
+            }
+        }
 
-        for (int i = 0; i < numSegments; i++) {
-            forward(sensitivity);
-            rotate(angleIncrement);
+        if (filling) {
+            recordArc(centerX, centerY, static_cast<float>(radius), startPhi, sweepRad);
         }
+        position.x = static_cast<LONG>(lround(centerX + radius * cos(startPhi + sweepRad)));
+        position.y = static_cast<LONG>(lround(centerY + radius * sin(startPhi + sweepRad)));
+        angle += sweepRad;
+        update();
     }
-    void drawText(const std::string& text, int fontSize, COLORREF textColor) {
-        HFONT font = CreateFont(fontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
-            OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, L"Arial");
-        HFONT oldFont = static_cast<HFONT>(SelectObject(hdc, font));
-        SetTextColor(hdc, textColor);
-        RECT rect = { position.x, position.y, position.x + 100, position.y + 100 };  // ʼ
-        DrawTextA(hdc, text.c_str(), -1, &rect, DT_CALCRECT);  // ıľС
 
-        DrawTextA(hdc, text.c_str(), -1, &rect, DT_SINGLELINE | DT_CENTER | DT_VCENTER);  // ı
-        SelectObject(hdc, oldFont);
-        DeleteObject(font);
+    // ӵǰλضαߣƵ (cx, cy) (x, y)
+    void quadTo(int cx, int cy, int x, int y) {
+        Path path;
+        path.MoveTo(static_cast<float>(position.x), static_cast<float>(position.y));
+        path.QuadTo(static_cast<float>(cx), static_cast<float>(cy), static_cast<float>(x), static_cast<float>(y));
+        followPath(path);
+    }
+    // ӵǰλαߣƵ (c1x, c1y)(c2x, c2y) (x, y)
+    void cubicTo(int c1x, int c1y, int c2x, int c2y, int x, int y) {
+        Path path;
+        path.MoveTo(static_cast<float>(position.x), static_cast<float>(position.y));
+        path.CubicTo(static_cast<float>(c1x), static_cast<float>(c1y), static_cast<float>(c2x), static_cast<float>(c2y),
+            static_cast<float>(x), static_cast<float>(y));
+        followPath(path);
+    }
+    // ӵǰλóһξ points ƽߣCatmull-Rom 
+    void splineThrough(const std::vector<POINT>& points) {
+        std::vector<POINTFLOAT> knots(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            knots[i].x = static_cast<float>(points[i].x);
+            knots[i].y = static_cast<float>(points[i].y);
+        }
+        Path path;
+        path.MoveTo(static_cast<float>(position.x), static_cast<float>(position.y));
+        path.CatmullRomTo(knots.data(), static_cast<int>(knots.size()));
+        followPath(path);
+    }
+    // ʼ¼֮ forwarddrawArcdrawCircleߺ gotoPos ·ᱻ¼
+    void beginFill() {
+        fillPath.Clear();
+        fillPath.MoveTo(static_cast<float>(position.x), static_cast<float>(position.y));
+        filling = true;
+    }
+    //  color  beginFill ֮¼Զպϣrule ཻǷ
+    void endFill(COLORREF color, BYTE alpha = 255, FillRule rule = FILL_NON_ZERO) {
+        if (!filling) {
+            return;
+        }
+        filling = false;
+        float left = 1e30f, top = 1e30f, right = -1e30f, bottom = -1e30f;
+        for (size_t c = 0; c < fillPath.contours.size(); c++) {
+            const std::vector<POINTFLOAT>& poly = fillPath.contours[c];
+            for (size_t i = 0; i < poly.size(); i++) {
+                left = min(left, poly[i].x);
+                top = min(top, poly[i].y);
+                right = max(right, poly[i].x);
+                bottom = max(bottom, poly[i].y);
+            }
+        }
+        if (left < right && top < bottom) {
+            SolidPaint paint(color, alpha);
+            composeRegion(left, top, right, bottom, 1.0f, [&](Surface& view, int x0, int y0) {
+                PolygonFiller filler(view);
+                filler.SetOrigin(x0, y0);
+                filler.SetRule(rule);
+                filler.Fill(fillPath, paint);
+            });
+        }
+        fillPath.Clear();
+    }
+    // ԵǰλΪϽǻıεһõʱդͼֻ֮
+    void drawText(const std::string& text, int fontSize, COLORREF textColor) {
+        int length = MultiByteToWideChar(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), NULL, 0);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<wchar_t> wide(length);
+        MultiByteToWideChar(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), wide.data(), length);
+        int font = glyphs.GetFont(L"Arial", fontSize);
+        int lines = 1;
+        int width = 0;
+        for (int i = 0, lineStart = 0; i <= length; i++) {
+            if (i == length || wide[i] == L'\n') {
+                width = max(width, glyphs.Measure(font, wide.data() + lineStart, i - lineStart));
+                lineStart = i + 1;
+                lines += i < length ? 1 : 0;
+            }
+        }
+        float left = static_cast<float>(position.x);
+        float top = static_cast<float>(position.y);
+        composeRegion(left, top, left + width, top + lines * glyphs.LineHeight(font), 0.0f, [&](Surface& view, int x0, int y0) {
+            glyphs.DrawString(view, position.x - x0, position.y - y0, font, wide.data(), length, textColor);
+        });
     }
 
 
+    //  (x, y) һͼ꣬ʵʻɶʱӰ
     void DrawIcon(int x, int y) {
         // std::cout << "X:" << x << " Y:" << y << std::endl;
-        Sleep(penSpeed);
-        if (iconWidth != 0 && iconHeight != 0) {
-            DrawIconEx(hdc, x, y, icon, iconWidth, iconHeight, 0, NULL, DI_NORMAL);
-        }
-        else {
-            DrawIconEx(hdc, x, y, icon, 0, 0, 0, NULL, DI_NORMAL);
-        }
+        queueStamp(static_cast<float>(x), static_cast<float>(y), angle);
+        update();
     }
     void SetIconSize(int width, int height) {
+        finish();
         iconWidth = width;
         iconHeight = height;
     }
+    // ʱѾߵͼ꣬
+    void update() {
+        size_t due = stampX.size();
+        if (penSpeed > 0) {
+            ULONGLONG elapsed = GetTickCount64() - clockStart;
+            due = min(due, clockIndex + static_cast<size_t>(elapsed / penSpeed) + 1);
+        }
+        if (due > revealed) {
+            emitStamps(revealed, due);
+            revealed = due;
+        }
+        if (revealed == stampX.size()) {
+            stampX.clear();
+            stampY.clear();
+            stampAngle.clear();
+            revealed = 0;
+            clockIndex = 0;
+        }
+    }
+    // ȴŶӵͼʾϣÿ֡һÿͼ˯һ
+    void finish() {
+        update();
+        while (!stampX.empty()) {
+            Sleep(FRAME_TIME);
+            update();
+        }
+    }
+    // δʾͼ
+    void cancel() {
+        stampX.clear();
+        stampY.clear();
+        stampAngle.clear();
+        revealed = 0;
+        clockIndex = 0;
+    }
+    size_t pendingStamps() const {
+        return stampX.size() - revealed;
+    }
     void clearCanvas() {
+        finish();
         RECT rect;
         GetClientRect(WindowFromDC(hdc), &rect);
         int width = rect.right;
@@ -168,6 +394,179 @@ public:
         ReleaseDC(NULL, hdcDesktop);
     }
 
+private:
+    int stampWidth() const {
+        return iconWidth != 0 ? iconWidth : GetSystemMetrics(SM_CXICON);
+    }
+    int stampHeight() const {
+        return iconHeight != 0 ? iconHeight : GetSystemMetrics(SM_CYICON);
+    }
+    void reserveStamps(int count) {
+        stampX.reserve(stampX.size() + count);
+        stampY.reserve(stampY.size() + count);
+        stampAngle.reserve(stampAngle.size() + count);
+    }
+    // һͼУȫڻֱӶתʱι㣩
+    void queueStamp(float x, float y, float stampAngleRad) {
+        int w = stampWidth();
+        int h = stampHeight();
+        int margin = rotateStamps ? (w + h) / 4 : 0;
+        if (x - margin >= canvas.right || y - margin >= canvas.bottom || x + w + margin <= canvas.left || y + h + margin <= canvas.top) {
+            return;
+        }
+        if (stampX.empty()) {
+            clockIndex = 0;
+            clockStart = GetTickCount64();
+        }
+        stampX.push_back(x);
+        stampY.push_back(y);
+        stampAngle.push_back(rotateStamps ? stampAngleRad : 0.0f);
+    }
+    // һͼֻͻһΣѸǷΧڴγ̱ľ黭ٿȥ
+    void emitStamps(size_t first, size_t last) {
+        int w = stampWidth();
+        int h = stampHeight();
+        RECT bounds = { canvas.right, canvas.bottom, canvas.left, canvas.top };
+        for (size_t i = first; i < last; i++) {
+            const SpriteCache::Sprite* sprite = sprites.Get(icon, w, h, stampAngle[i]);
+            if (sprite == NULL) {
+                drawStampsWithGdi(first, last);
+                return;
+            }
+            int x = static_cast<int>(stampX[i]) + sprite->offsetX;
+            int y = static_cast<int>(stampY[i]) + sprite->offsetY;
+            bounds.left = min(bounds.left, x);
+            bounds.top = min(bounds.top, y);
+            bounds.right = max(bounds.right, x + sprite->image.width);
+            bounds.bottom = max(bounds.bottom, y + sprite->image.height);
+        }
+        bounds.left = max(bounds.left, canvas.left);
+        bounds.top = max(bounds.top, canvas.top);
+        bounds.right = min(bounds.right, canvas.right);
+        bounds.bottom = min(bounds.bottom, canvas.bottom);
+        int boundsWidth = bounds.right - bounds.left;
+        int boundsHeight = bounds.bottom - bounds.top;
+        if (boundsWidth <= 0 || boundsHeight <= 0) {
+            return;
+        }
+        if (batch.width < boundsWidth || batch.height < boundsHeight) {
+            batch.Create(max(batch.width, boundsWidth), max(batch.height, boundsHeight));
+            if (batch.Empty()) {
+                drawStampsWithGdi(first, last);
+                return;
+            }
+        }
+
+        batch.Capture(hdc, bounds.left, bounds.top, 0, 0, boundsWidth, boundsHeight);
+        Surface view(batch.pixels, batch.width, boundsHeight);
+        for (size_t i = first; i < last; i++) {
+            const SpriteCache::Sprite* sprite = sprites.Get(icon, w, h, stampAngle[i]);
+            if (sprite == NULL) {
+                continue;
+            }
+            int x = static_cast<int>(stampX[i]) + sprite->offsetX - bounds.left;
+            int y = static_cast<int>(stampY[i]) + sprite->offsetY - bounds.top;
+            sprite->rle.Blit(view, x, y);
+        }
+        batch.Present(hdc, bounds.left, bounds.top, 0, 0, boundsWidth, boundsHeight);
+    }
+    // չƽ·ͼ갴ȼã㲻ظţģʽֱӻ
+    // 󻭱ͣ·յ㣬Ϊյ㴦߷
+    void followPath(const Path& path) {
+        if (path.Empty() || path.contours.back().size() < 2) {
+            return;
+        }
+        const std::vector<POINTFLOAT>& poly = path.contours.back();
+        if (penState && strokeMode) {
+            float left = poly[0].x, top = poly[0].y, right = left, bottom = top;
+            for (size_t i = 1; i < poly.size(); i++) {
+                left = min(left, poly[i].x);
+                top = min(top, poly[i].y);
+                right = max(right, poly[i].x);
+                bottom = max(bottom, poly[i].y);
+            }
+            strokeRegion(left, top, right, bottom, [&](Rasterizer& raster) {
+                raster.DrawPolyline(poly.data(), static_cast<int>(poly.size()));
+            });
+        }
+        else if (penState) {
+            std::vector<POINTFLOAT> points;
+            std::vector<float> angles;
+            path.Resample(static_cast<float>(sensitivity), points, &angles);
+            reserveStamps(static_cast<int>(points.size()));
+            for (size_t i = 1; i < points.size(); i++) {
+                queueStamp(points[i].x, points[i].y, angles[i]);
+            }
+        }
+
+        if (filling) {
+            for (size_t i = 1; i < poly.size(); i++) {
+                fillPath.LineTo(poly[i].x, poly[i].y);
+            }
+        }
+        const POINTFLOAT& last = poly.back();
+        const POINTFLOAT& before = poly[poly.size() - 2];
+        angle = atan2f(last.y - before.y, last.x - before.x);
+        position.x = static_cast<LONG>(lround(last.x));
+        position.y = static_cast<LONG>(lround(last.y));
+        update();
+    }
+    // ڻ [left, right] x [top, bottom] Χ߿ùդ
+    template <typename DrawFunc>
+    void strokeRegion(float left, float top, float right, float bottom, DrawFunc draw) {
+        composeRegion(left, top, right, bottom, strokeWidth * 0.5f + 2.0f, [&](Surface& view, int x0, int y0) {
+            Rasterizer raster(view);
+            raster.SetOrigin(x0, y0);
+            raster.SetColor(strokeColor);
+            raster.SetWidth(strokeWidth);
+            draw(raster);
+        });
+    }
+    // ȻŶеͼٰ꣬ [left, right] x [top, bottom]  pad 򿽵ڴ
+    //  draw(view, x0, y0) ú󿽻ȥview  (0, 0) Ӧϵ (x0, y0)
+    template <typename DrawFunc>
+    void composeRegion(float left, float top, float right, float bottom, float pad, DrawFunc draw) {
+        finish();
+        int x0 = max(static_cast<int>(canvas.left), static_cast<int>(floorf(left - pad)));
+        int y0 = max(static_cast<int>(canvas.top), static_cast<int>(floorf(top - pad)));
+        int x1 = min(static_cast<int>(canvas.right), static_cast<int>(ceilf(right + pad)));
+        int y1 = min(static_cast<int>(canvas.bottom), static_cast<int>(ceilf(bottom + pad)));
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        if (batch.width < x1 - x0 || batch.height < y1 - y0) {
+            batch.Create(max(batch.width, x1 - x0), max(batch.height, y1 - y0));
+            if (batch.Empty()) {
+                return;
+            }
+        }
+        batch.Capture(hdc, x0, y0, 0, 0, x1 - x0, y1 - y0);
+        Surface view(batch.pixels, batch.width, y1 - y0);
+        draw(view, x0, y0);
+        batch.Present(hdc, x0, y0, 0, 0, x1 - x0, y1 - y0);
+    }
+    // һԲԼ 2 һε߼¼㣩
+    void recordArc(float centerX, float centerY, float radius, float startPhi, float sweepRad) {
+        int steps = max(4, static_cast<int>(ceil(fabs(sweepRad) * radius / 2.0f)));
+        for (int i = 1; i <= steps; i++) {
+            float phi = startPhi + sweepRad * i / steps;
+            fillPath.LineTo(centerX + radius * cosf(phi), centerY + radius * sinf(phi));
+        }
+    }
+    // 鲻ʱ˻ص DrawIconEx
+    void drawStampsWithGdi(size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            int x = static_cast<int>(stampX[i]);
+            int y = static_cast<int>(stampY[i]);
+            if (iconWidth != 0 && iconHeight != 0) {
+                DrawIconEx(hdc, x, y, icon, iconWidth, iconHeight, 0, NULL, DI_NORMAL);
+            }
+            else {
+                DrawIconEx(hdc, x, y, icon, 0, 0, 0, NULL, DI_NORMAL);
+            }
+        }
+    }
+
 };
 HICON loadCustomIcon(HINSTANCE hInstance, LPCTSTR resourceName, int iconWidth, int iconHeight) {
     HICON hCustomIcon = LoadIcon(hInstance, resourceName);